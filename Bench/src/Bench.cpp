@@ -0,0 +1,814 @@
+#include <Game.h>
+#include <Batch.h>
+#include <Bot.h>
+#include <BeamSearch.h>
+#include <Mcts.h>
+#include <AsyncAi.h>
+#include <MoveGen.h>
+#include <Landing.h>
+#include <DropMask.h>
+#include <TranspositionTable.h>
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <set>
+#include <string>
+#include <thread>
+#include <unordered_set>
+#include <vector>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#define BENCH_HAS_TSC 1
+#elif defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define BENCH_HAS_TSC 1
+#endif
+
+typedef Grid<10, 20> Board;
+
+//results are added into this so the compiler can't drop the work being timed
+volatile uint64_t sink;
+
+uint64_t Cycles() {
+#ifdef BENCH_HAS_TSC
+	return __rdtsc();
+#else
+	return 0;
+#endif
+}
+
+struct Result {
+	std::string name;
+	double medianNs;
+	double p99Ns;
+	double minNs;
+	double cyclesPerOp;
+};
+
+struct Settings {
+	int samples;
+	//how long one sample should run for, ops per sample are picked to fit
+	double sampleSeconds;
+	const char* filter;
+};
+
+//times body(ops) over many samples, each sample runs enough ops to be long compared to the clock
+//the median and p99 are over the per op times of the samples, so one slow sample doesn't move the median
+template<class Body>
+bool Measure(const Settings& settings, const char* name, Body body, std::vector<Result>& results) {
+	if (settings.filter && !strstr(name, settings.filter))
+		return false;
+	typedef std::chrono::steady_clock Clock;
+	int ops = 1;
+	while (true) {
+		Clock::time_point start = Clock::now();
+		sink = sink + body(ops);
+		if (((std::chrono::duration<double>)(Clock::now() - start)).count() >= settings.sampleSeconds || ops >= (1 << 24))
+			break;
+		ops *= 2;
+	}
+
+	std::vector<double> perOp(settings.samples);
+	uint64_t cycles = 0;
+	for (int s = 0; s < settings.samples; s++) {
+		Clock::time_point start = Clock::now();
+		uint64_t startCycles = Cycles();
+		sink = sink + body(ops);
+		cycles += Cycles() - startCycles;
+		perOp[s] = ((std::chrono::duration<double>)(Clock::now() - start)).count() * 1e9 / ops;
+	}
+	std::sort(perOp.begin(), perOp.end());
+	Result result;
+	result.name = name;
+	result.medianNs = perOp[perOp.size() / 2];
+	result.p99Ns = perOp[std::min(perOp.size() - 1, perOp.size() * 99 / 100)];
+	result.minNs = perOp[0];
+	result.cyclesPerOp = double(cycles) / (double(ops) * settings.samples);
+	results.push_back(result);
+	printf("%-32s %10.2f %10.2f %10.2f %10.1f\n", name, result.medianNs, result.p99Ns, result.minNs, result.cyclesPerOp);
+	return true;
+}
+
+//a board stacked to height rows, with full rows of them spread evenly through it and a hole in every other row
+Board MakeBoard(Random& random, int height, int full) {
+	Board board;
+	for (int y = 0; y < height; y++) {
+		bool isFull = full > 0 && y % std::max(1, height / full) == 0 && full-- > 0;
+		Board::RowMask row = isFull ? Board::fullRow : Board::RowMask(Board::fullRow & ~(Board::RowMask(1) << random.Below(Board::width)));
+		board.Add(y, row, 1);
+	}
+	return board;
+}
+
+uint64_t FullHash(const Board& board) {
+	uint64_t hash = 0;
+	for (int y = 0; y < Board::height; y++)
+		hash ^= Board::RowHash(board.row(y), y);
+	return hash;
+}
+
+//heights, holes, bumpiness and row transitions worked out cell by cell, as an evaluator would without the grid's help
+int FullSurface(const Board& board) {
+	int heights[Board::width] = {};
+	int blocks = 0, transitions = 0;
+	for (int y = 0; y < Board::height; y++) {
+		Board::RowMask row = board.row(y);
+		if (row == 0)
+			continue;
+		int previous = 1;
+		for (int x = 0; x < Board::width; x++) {
+			int filled = (row >> x) & 1;
+			if (filled) {
+				heights[x] = y + 1;
+				blocks++;
+			}
+			transitions += filled != previous;
+			previous = filled;
+		}
+		transitions += !previous;
+	}
+	int heightSum = 0, bumpiness = 0;
+	for (int x = 0; x < Board::width; x++) {
+		heightSum += heights[x];
+		if (x > 0)
+			bumpiness += std::abs(heights[x] - heights[x - 1]);
+	}
+	return heightSum + (heightSum - blocks) + bumpiness + transitions;
+}
+
+void RunAll(const Settings& settings, std::vector<Result>& results) {
+	Random random(1);
+	const int boardCount = 64;
+
+	{
+		Board board = MakeBoard(random, 12, 0);
+		const int positionCount = 256;
+		std::vector<ivec2> positions;
+		for (int i = 0; i < positionCount; i++)
+			positions.push_back(ivec2(random.Below(Board::width), random.Below(Board::height)));
+		Measure(settings, "Grid::isBlockHere", [&](int ops) {
+			uint64_t found = 0;
+			for (int i = 0; i < ops; i++)
+				found += board.isBlockHere(positions[i % positionCount]);
+			return found;
+		}, results);
+	}
+
+	//each op copies a board and clears it
+	static const int fills[][2] = { { 4, 1 }, { 10, 2 }, { 16, 4 }, { 19, 0 } };
+	for (const int* fill : fills) {
+		std::vector<Board> boards;
+		for (int i = 0; i < boardCount; i++)
+			boards.push_back(MakeBoard(random, fill[0], fill[1]));
+		char name[64];
+		snprintf(name, sizeof(name), "Grid::DoRemoval %d rows %d full", fill[0], fill[1]);
+		Measure(settings, name, [&](int ops) {
+			uint64_t total = 0;
+			for (int i = 0; i < ops; i++) {
+				Board board = boards[i % boardCount];
+				total += board.DoRemoval();
+			}
+			return total;
+		}, results);
+	}
+
+	std::vector<Board> boards;
+	for (int i = 0; i < boardCount; i++)
+		boards.push_back(MakeBoard(random, 2 + random.Below(10), 0));
+	std::vector<FallingPiece> pieces;
+	for (int i = 0; i < boardCount; i++) {
+		FallingPiece piece(random.Below(numOfBockTypes), ivec2(random.Below(Board::width), 4 + random.Below(12)));
+		piece.rotation = random.Below(pieceTable.pieces[piece.type].count);
+		pieces.push_back(piece);
+	}
+
+	Measure(settings, "FallingPiece::ConflictingBlocks", [&](int ops) {
+		uint64_t total = 0;
+		for (int i = 0; i < ops; i++)
+			total += pieces[i % boardCount].ConflictingBlocks({ 0,-1 }, boards[(i / boardCount + i) % boardCount]);
+		return total;
+	}, results);
+
+	Measure(settings, "FallingPiece::Rotate", [&](int ops) {
+		uint64_t total = 0;
+		for (int i = 0; i < ops; i++) {
+			FallingPiece piece = pieces[i % boardCount];
+			piece.Rotate(boards[(i / boardCount + i) % boardCount]);
+			total += piece.rotation;
+		}
+		return total;
+	}, results);
+
+	//pieces dropped from the spawn row onto the stacked boards, as a hard drop or a bot does
+	{
+		std::vector<FallingPiece> spawned;
+		for (int i = 0; i < boardCount; i++) {
+			FallingPiece piece(random.Below(numOfBockTypes), Board::SpawnPosition());
+			piece.rotation = random.Below(pieceTable.pieces[piece.type].count);
+			piece.pos.x = random.Below(Board::width - piece.CurrentPiece().width + 1) - piece.CurrentPiece().minX;
+			spawned.push_back(piece);
+		}
+		Measure(settings, "FallingPiece::dropDistance", [&](int ops) {
+			uint64_t total = 0;
+			for (int i = 0; i < ops; i++)
+				total += spawned[i % boardCount].dropDistance(boards[(i / boardCount + i) % boardCount]);
+			return total;
+		}, results);
+		//what dropping cost before, one collision test per row
+		Measure(settings, "drop row by row", [&](int ops) {
+			uint64_t total = 0;
+			for (int i = 0; i < ops; i++) {
+				const FallingPiece& piece = spawned[i % boardCount];
+				const Board& board = boards[(i / boardCount + i) % boardCount];
+				int distance = 0;
+				while (piece.CanMoveThisWay({ 0,-distance - 1 }, board))
+					distance++;
+				total += distance;
+			}
+			return total;
+		}, results);
+	}
+
+	//every straight drop of one piece, all its rotations at every column
+	{
+		uint8_t rows[64];
+		Measure(settings, "LandingRowsScalar every drop", [&](int ops) {
+			uint64_t total = 0;
+			for (int i = 0; i < ops; i++) {
+				int type = i % numOfBockTypes;
+				for (int r = 0; r < dropTable.counts[type]; r++)
+					total += LandingRowsScalar(boards[i % boardCount], type, r, rows) + rows[0];
+			}
+			return total;
+		}, results);
+		Measure(settings, "LandingRows every drop", [&](int ops) {
+			uint64_t total = 0;
+			for (int i = 0; i < ops; i++) {
+				int type = i % numOfBockTypes;
+				for (int r = 0; r < dropTable.counts[type]; r++)
+					total += LandingRows(boards[i % boardCount], type, r, rows) + rows[0];
+			}
+			return total;
+		}, results);
+	}
+
+	//the same drops as a legality and landing mask, from the spawn row
+	{
+		DropMask<Board> mask;
+		int startY = Board::SpawnPosition().y;
+		Measure(settings, "DropMaskReference", [&](int ops) {
+			uint64_t total = 0;
+			for (int i = 0; i < ops; i++) {
+				DropMaskReference(boards[i % boardCount], i % numOfBockTypes, startY, mask);
+				total += mask.legal[0] + mask.landing[0][0];
+			}
+			return total;
+		}, results);
+		Measure(settings, "DropMaskLanes", [&](int ops) {
+			uint64_t total = 0;
+			for (int i = 0; i < ops; i++) {
+				DropMaskLanes(boards[i % boardCount], i % numOfBockTypes, startY, mask);
+				total += mask.legal[0] + mask.landing[0][0];
+			}
+			return total;
+		}, results);
+#if defined(TETRIS_X86)
+		if (HasAvx2())
+			Measure(settings, "DropMaskAvx2", [&](int ops) {
+				uint64_t total = 0;
+				for (int i = 0; i < ops; i++) {
+					DropMaskAvx2(boards[i % boardCount], i % numOfBockTypes, startY, mask);
+					total += mask.legal[0] + mask.landing[0][0];
+				}
+				return total;
+			}, results);
+#endif
+	}
+
+	{
+		PieceQueue queue(1, RandomizerType::Bag);
+		Measure(settings, "spawn", [&](int ops) {
+			uint64_t total = 0;
+			for (int i = 0; i < ops; i++) {
+				FallingPiece piece(queue.Pop(), Board::SpawnPosition());
+				total += piece.CanMoveThisWay({ 0,0 }, boards[i % boardCount]);
+			}
+			return total;
+		}, results);
+	}
+
+	{
+		MoveGen<Board> gen;
+		Measure(settings, "MoveGen::Generate", [&](int ops) {
+			uint64_t total = 0;
+			for (int i = 0; i < ops; i++)
+				total += gen.Generate(boards[i % boardCount], FallingPiece(i % numOfBockTypes, Board::SpawnPosition()));
+			return total;
+		}, results);
+	}
+
+	{
+		Measure(settings, "Grid::hash", [&](int ops) {
+			uint64_t total = 0;
+			for (int i = 0; i < ops; i++)
+				total += boards[i % boardCount].hash();
+			return total;
+		}, results);
+		//what hash() would cost without the incremental updates
+		Measure(settings, "Grid::hash from scratch", [&](int ops) {
+			uint64_t total = 0;
+			for (int i = 0; i < ops; i++)
+				total += FullHash(boards[i % boardCount]);
+			return total;
+		}, results);
+	}
+
+	{
+		Measure(settings, "Grid surface", [&](int ops) {
+			uint64_t total = 0;
+			for (int i = 0; i < ops; i++) {
+				const Board& board = boards[i % boardCount];
+				total += board.heightSum + board.holes() + board.bumpiness() + board.rowTransitions();
+			}
+			return total;
+		}, results);
+		Measure(settings, "Grid surface from scratch", [&](int ops) {
+			uint64_t total = 0;
+			for (int i = 0; i < ops; i++)
+				total += FullSurface(boards[i % boardCount]);
+			return total;
+		}, results);
+	}
+
+	//hashes spread over a table much bigger than the cache, as in a long search
+	{
+		TranspositionTable<Board> table(256);
+		const int hashCount = 1 << 16;
+		std::vector<uint64_t> hashes(hashCount);
+		for (uint64_t& hash : hashes)
+			hash = random.Next();
+		Measure(settings, "TranspositionTable::Store", [&](int ops) {
+			for (int i = 0; i < ops; i++)
+				table.Store(hashes[i % hashCount] + i / hashCount, float(i), i & 7, i & 3, i % Board::width, i % Board::height);
+			return uint64_t(ops);
+		}, results);
+		Measure(settings, "TranspositionTable::Probe", [&](int ops) {
+			uint64_t found = 0;
+			TTEntry entry;
+			for (int i = 0; i < ops; i++)
+				found += table.Probe(hashes[i % hashCount] + i / hashCount, entry);
+			return found;
+		}, results);
+	}
+
+	//a placement is generating, evaluating and locking one piece, the bot rarely loses but games restart if it does
+	{
+		std::unique_ptr<Bot<Board>> bot(new Bot<Board>());
+		Game<Board> game(1);
+		uint64_t seed = 1;
+		Measure(settings, "Bot::Play placement", [&](int ops) {
+			for (int i = 0; i < ops; i++)
+				if (!bot->Play(game))
+					game = Game<Board>(++seed);
+			return uint64_t(game.lines);
+		}, results);
+	}
+
+	//one move of a three piece lookahead keeping 32 boards, on one thread so it compares across machines
+	{
+		ThreadPool pool(1);
+		std::unique_ptr<BeamSearch<Board>> beam(new BeamSearch<Board>(pool, 3, 32));
+		Game<Board> game(1);
+		uint64_t seed = 1;
+		Measure(settings, "BeamSearch move depth 3 width 32", [&](int ops) {
+			for (int i = 0; i < ops; i++)
+				if (!beam->Play(game))
+					game = Game<Board>(++seed);
+			return uint64_t(game.lines);
+		}, results);
+	}
+
+	//the shortest move the tree search can make, moving the tree on to the next piece and the greedy rollout with no
+	//iteration, the time a longer budget doesn't spend iterating
+	{
+		ThreadPool pool(1);
+		std::unique_ptr<Mcts<Board>> mcts(new Mcts<Board>(pool, 1e-6));
+		Game<Board> game(1);
+		uint64_t seed = 1;
+		Measure(settings, "Mcts move 1 us budget", [&](int ops) {
+			for (int i = 0; i < ops; i++)
+				if (!mcts->Play(game))
+					game = Game<Board>(++seed);
+			return uint64_t(game.lines);
+		}, results);
+	}
+
+	//what a frame pays to keep the background search on the current position and read its answer, with the position
+	//changing every eighth frame, which has to stay flat however long the search runs
+	{
+		std::vector<Game<Board>> positions;
+		std::unique_ptr<Bot<Board>> bot(new Bot<Board>());
+		Game<Board> game(1);
+		for (int i = 0; i < 64; i++) {
+			positions.push_back(game);
+			if (!bot->Play(game))
+				game = Game<Board>(i);
+		}
+		AsyncAi<Board> ai(1);
+		int frame = 0;
+		Measure(settings, "AsyncAi Submit per frame", [&](int ops) {
+			uint64_t found = 0;
+			for (int i = 0; i < ops; i++, frame++) {
+				ai.Submit(positions[(frame / 8) % positions.size()]);
+				FallingPiece hint = positions[0].piece;
+				found += ai.Suggestion(hint);
+			}
+			return found;
+		}, results);
+	}
+
+	//random keys, so games run a mix of moves, rotations, locks and clears, and are restarted when lost
+	{
+		const int actionCount = 4096;
+		std::vector<InputFrame> inputs(actionCount);
+		for (InputFrame& input : inputs) {
+			int key = random.Below(numOfKeys + 2);
+			if (key < numOfKeys)
+				input.held[key] = true;
+		}
+		Game<Board> game(1);
+		uint64_t seed = 1;
+		Measure(settings, "Game::Step", [&](int ops) {
+			for (int i = 0; i < ops; i++)
+				if (!game.Step(inputs[i % actionCount]))
+					game = Game<Board>(++seed);
+			return uint64_t(game.pieces);
+		}, results);
+	}
+
+	//per game stepped, with the same keys as Game::Step above, so the two line up
+	{
+		const int games = 256;
+		const int steps = 64;
+		std::vector<uint64_t> seeds(games);
+		for (int g = 0; g < games; g++)
+			seeds[g] = g + 1;
+		std::vector<uint8_t> keys(games * steps);
+		for (uint8_t& key : keys) {
+			int k = random.Below(numOfKeys + 2);
+			key = k < numOfKeys ? uint8_t(1 << k) : 0;
+		}
+		typedef Batch<10, 20, games> Games;
+		std::unique_ptr<Games> batch(new Games(seeds.data()));
+		int step = 0;
+		uint64_t seed = games;
+		Measure(settings, "Batch::Step per game", [&](int ops) {
+			for (int i = 0; i < ops; i += games) {
+				batch->Step(&keys[(step++ % steps) * games]);
+				for (int g = 0; g < games; g++)
+					if (batch->lost[g])
+						batch->Reset(g, ++seed);
+			}
+			return uint64_t(batch->pieces[0]);
+		}, results);
+	}
+}
+
+//plays random games and keeps the board after every lock, then counts how many distinct boards share a hash,
+//both for the full hash and for its low 32 bits where collisions are expected, and checks the incremental hash
+void HashReport(int boardsWanted) {
+	std::set<std::array<Board::RowMask, Board::height>> distinct;
+	std::unordered_set<uint64_t> hashes;
+	std::unordered_set<uint32_t> lowHashes;
+	int mismatched = 0;
+	Random random(7);
+	for (uint64_t seed = 1; int(distinct.size()) < boardsWanted; seed++) {
+		Game<Board> game(seed);
+		int pieces = 0;
+		while (int(distinct.size()) < boardsWanted) {
+			InputFrame input;
+			input.held[random.Below(numOfKeys)] = true;
+			if (!game.Step(input))
+				break;
+			if (game.pieces == pieces)
+				continue;
+			pieces = game.pieces;
+			std::array<Board::RowMask, Board::height> rows;
+			for (int y = 0; y < Board::height; y++)
+				rows[y] = game.grid.row(y);
+			if (!distinct.insert(rows).second)
+				continue;
+			mismatched += game.grid.hash() != FullHash(game.grid);
+			hashes.insert(game.grid.hash());
+			lowHashes.insert(uint32_t(game.grid.hash()));
+		}
+	}
+	double n = double(distinct.size());
+	printf("\nhash collisions over %.0f distinct boards\n", n);
+	printf("  64 bit  %zu\n", distinct.size() - hashes.size());
+	printf("  32 bit  %zu, about %.1f expected from a random function\n", distinct.size() - lowHashes.size(), n * n / 2 / 4294967296.0);
+	printf("  incremental hash differs from a full rehash on %d boards\n", mismatched);
+}
+
+bool SameDropMask(const DropMask<Board>& a, const DropMask<Board>& b) {
+	return a.count == b.count && !memcmp(a.legal, b.legal, sizeof(a.legal)) && !memcmp(a.landing, b.landing, sizeof(a.landing));
+}
+
+//differential test of the drop mask kernels against the reference on boards from random games,
+//from the spawn row and from rows down inside the stack, returns the number of masks that differ
+int DropMaskReport(int boardsWanted) {
+	Random random(11);
+	int boards = 0, differing = 0;
+	for (uint64_t seed = 1; boards < boardsWanted; seed++) {
+		Game<Board> game(seed);
+		int pieces = 0;
+		while (boards < boardsWanted) {
+			InputFrame input;
+			input.held[random.Below(numOfKeys)] = true;
+			if (!game.Step(input))
+				break;
+			if (game.pieces == pieces)
+				continue;
+			pieces = game.pieces;
+			boards++;
+			for (int type = 0; type < numOfBockTypes; type++) {
+				int startY = type % 2 ? Board::SpawnPosition().y : int(random.Below(Board::height + 2)) - 2;
+				DropMask<Board> reference, lanes;
+				DropMaskReference(game.grid, type, startY, reference);
+				DropMaskLanes(game.grid, type, startY, lanes);
+				differing += !SameDropMask(reference, lanes);
+#if defined(TETRIS_X86)
+				if (HasAvx2()) {
+					DropMask<Board> avx2;
+					DropMaskAvx2(game.grid, type, startY, avx2);
+					differing += !SameDropMask(reference, avx2);
+				}
+#endif
+			}
+		}
+	}
+	printf("\ndrop masks differing from the reference over %d boards: %d\n", boards, differing);
+	return differing;
+}
+
+//whether game g of batch is where game is, its piece, counters and every row
+template<class Games>
+bool SameAsGame(const Games& batch, int g, const Game<Board>& game) {
+	FallingPiece piece = batch.piece(g);
+	bool same = game.lost == (batch.lost[g] != 0) && game.lines == batch.lines[g] && game.pieces == batch.pieces[g]
+		&& game.ticks == batch.ticks[g] && game.piece.type == piece.type && game.piece.rotation == piece.rotation && game.piece.pos == piece.pos;
+	for (int y = 0; y < Board::height; y++)
+		same = same && game.grid.row(y) == batch.row(g, y);
+	return same;
+}
+
+//differential test of Batch against Game::Step, half the games hold a random set of keys for a few ticks at a time
+//so auto shift, lock delay and gravity all come up, the other half press the bot's keys so rows get cleared,
+//returns the number of steps on which a game differs
+template<int Count>
+int BatchReport(int steps) {
+	typedef Batch<10, 20, Count> Games;
+	Random random(5);
+	std::vector<uint64_t> seeds(Count);
+	std::vector<Game<Board>> games;
+	for (int g = 0; g < Count; g++) {
+		seeds[g] = g + 1;
+		games.push_back(Game<Board>(seeds[g]));
+	}
+	std::unique_ptr<Games> batch(new Games(seeds.data()));
+	std::vector<uint8_t> keys(Count, 0);
+	std::vector<int> ticksLeft(Count, 0);
+	std::vector<std::unique_ptr<Bot<Board>>> bots(Count);
+	for (int g = 1; g < Count; g += 2)
+		bots[g].reset(new Bot<Board>());
+	uint64_t nextSeed = Count + 1;
+	int differing = 0;
+	long long lines = 0;
+	for (int step = 0; step < steps; step++) {
+		for (int g = 0; g < Count; g++)
+			if (bots[g])
+				keys[g] = Games::KeyBits(bots[g]->Input(games[g]));
+			else if (ticksLeft[g]-- <= 0) {
+				keys[g] = uint8_t(random.Below(1 << numOfKeys)) & uint8_t(random.Below(1 << numOfKeys));
+				ticksLeft[g] = random.Below(12);
+			}
+		batch->Step(keys.data());
+		for (int g = 0; g < Count; g++) {
+			Game<Board>& game = games[g];
+			InputFrame input;
+			for (int k = 0; k < numOfKeys; k++)
+				input.held[k] = (keys[g] >> k & 1) != 0;
+			game.Step(input);
+			bool same = SameAsGame(*batch, g, game);
+			differing += !same;
+			if (game.lost || !same || game.pieces >= 500) {
+				lines += game.lines;
+				game = Game<Board>(nextSeed);
+				batch->Reset(g, nextSeed++);
+			}
+		}
+	}
+	printf("\nbatch steps differing from Game::Step over %d steps of %d games, %lld lines cleared: %d\n",
+		steps, Count, lines, differing);
+	return differing;
+}
+
+//one game hard drops while the games beside it don't: one holds down so its piece sits low on the stack,
+//one is lost and left lost, and one presses nothing, so a drop that moved any game but the dropping one
+//would show, returns the number of steps on which a game differs from Game::Step
+int BatchDropReport(int steps) {
+	typedef Batch<10, 20, 4> Games;
+	enum { holdsDown, drops, dead, idle };
+	uint64_t seeds[4] = { 1, 2, 3, 4 };
+	std::vector<Game<Board>> games;
+	for (uint64_t seed : seeds)
+		games.push_back(Game<Board>(seed));
+	std::unique_ptr<Games> batch(new Games(seeds));
+	uint64_t nextSeed = 5;
+	int differing = 0;
+	for (int step = 0; step < steps; step++) {
+		uint8_t keys[4] = {};
+		keys[holdsDown] = uint8_t(1 << KeyDown);
+		//every other tick, so each press is a new one, and sideways in between so the drops land all over
+		keys[drops] = uint8_t(step % 2 ? 1 << KeyHardDrop : step % 6 == 0 ? 1 << KeyLeft : step % 6 == 2 ? 1 << KeyRight : 0);
+		keys[dead] = uint8_t(step % 2 ? 1 << KeyHardDrop : 0);
+		batch->Step(keys);
+		for (int g = 0; g < 4; g++) {
+			InputFrame input;
+			for (int k = 0; k < numOfKeys; k++)
+				input.held[k] = (keys[g] >> k & 1) != 0;
+			games[g].Step(input);
+			bool same = SameAsGame(*batch, g, games[g]);
+			differing += !same;
+			if ((games[g].lost && g != dead) || !same) {
+				games[g] = Game<Board>(nextSeed);
+				batch->Reset(g, nextSeed++);
+			}
+		}
+	}
+	printf("\nbatch steps differing from Game::Step with one game hard dropping beside idle and lost ones over %d steps: %d\n",
+		steps, differing);
+	return differing;
+}
+
+//threads storing and probing one small table at once, every entry's contents follow from its hash,
+//so a probe that returns anything else has seen a torn or mixed up entry, returns how many did plus any probes the counters lost
+//it runs the threads twice over, so the second lot take the stripes the first lot gave back
+int TranspositionReport(int threadCount, int opsPerThread) {
+	TranspositionTable<Board> table(1);
+	const int hashCount = 1 << 17;
+	std::vector<uint64_t> hashes(hashCount);
+	Random random(9);
+	for (uint64_t& hash : hashes)
+		hash = random.Next();
+	std::atomic<int> wrong(0);
+	std::atomic<uint64_t> probes(0);
+	auto work = [&](int t) {
+		Random ops(uint64_t(t) + 1);
+		uint64_t probed = 0;
+		for (int i = 0; i < opsPerThread; i++) {
+			uint64_t hash = hashes[ops.Below(hashCount)];
+			int depth = int(hash & 7), rotation = int(hash >> 3 & 3), x = int(hash >> 5 & 7), y = int(hash >> 8 & 15);
+			float score = float(hash >> 40);
+			TTEntry entry;
+			if (ops.Below(2)) {
+				table.Store(hash, score, depth, rotation, x, y);
+				continue;
+			}
+			probed++;
+			if (table.Probe(hash, entry) && (entry.score != score || entry.depth != depth || entry.rotation != rotation
+				|| entry.x != x || entry.y != y))
+				wrong++;
+		}
+		probes += probed;
+	};
+	for (int round = 0; round < 2; round++) {
+		std::vector<std::thread> threads;
+		for (int t = 0; t < threadCount; t++)
+			threads.push_back(std::thread(work, round * threadCount + t));
+		for (std::thread& thread : threads)
+			thread.join();
+	}
+	//no more threads than stripes count at once, so no probe should go uncounted
+	TranspositionTable<Board>::Stats stats = table.stats();
+	uint64_t lost = probes.load() - std::min(probes.load(), stats.probes);
+	printf("\ntransposition table stress, 2 x %d threads x %d ops: wrong entries %d, hits %llu of %llu probes, "
+		"%llu stores, %llu replaced, %llu rejected, %llu contended, probes not counted %llu\n",
+		threadCount, opsPerThread, wrong.load(), (unsigned long long)stats.hits, (unsigned long long)stats.probes,
+		(unsigned long long)stats.stores, (unsigned long long)stats.replaced, (unsigned long long)stats.rejected,
+		(unsigned long long)stats.contended, (unsigned long long)lost);
+	return wrong.load() + int(lost);
+}
+
+void WriteJson(const char* path, const std::vector<Result>& results) {
+	FILE* file = fopen(path, "w");
+	if (!file) {
+		printf("can't write %s\n", path);
+		return;
+	}
+	fprintf(file, "{\n  \"benchmarks\": [\n");
+	for (size_t i = 0; i < results.size(); i++) {
+		const Result& r = results[i];
+		fprintf(file, "    { \"name\": \"%s\", \"median_ns\": %.3f, \"p99_ns\": %.3f, \"min_ns\": %.3f, \"cycles_per_op\": %.2f }%s\n",
+			r.name.c_str(), r.medianNs, r.p99Ns, r.minNs, r.cyclesPerOp, i + 1 < results.size() ? "," : "");
+	}
+	fprintf(file, "  ]\n}\n");
+	fclose(file);
+}
+
+//only reads back what WriteJson writes, the name and median of each benchmark
+bool ReadJson(const char* path, std::vector<Result>& results) {
+	FILE* file = fopen(path, "r");
+	if (!file)
+		return false;
+	std::string text;
+	char buffer[4096];
+	for (size_t n; (n = fread(buffer, 1, sizeof(buffer), file)) > 0;)
+		text.append(buffer, n);
+	fclose(file);
+
+	const std::string nameKey = "\"name\": \"", medianKey = "\"median_ns\": ";
+	for (size_t at = text.find(nameKey); at != std::string::npos; at = text.find(nameKey, at)) {
+		at += nameKey.size();
+		size_t end = text.find('"', at);
+		size_t median = text.find(medianKey, end);
+		if (end == std::string::npos || median == std::string::npos)
+			return false;
+		Result result = Result();
+		result.name = text.substr(at, end - at);
+		result.medianNs = atof(text.c_str() + median + medianKey.size());
+		results.push_back(result);
+	}
+	return true;
+}
+
+//returns the number of benchmarks whose median got slower than the baseline by more than threshold percent
+int Compare(const std::vector<Result>& results, const std::vector<Result>& baseline, double threshold) {
+	int regressions = 0;
+	printf("\n%-32s %10s %10s %8s\n", "compared to baseline", "before", "after", "change");
+	for (const Result& result : results)
+		for (const Result& before : baseline)
+			if (before.name == result.name) {
+				double change = 100 * (result.medianNs - before.medianNs) / before.medianNs;
+				bool slower = change > threshold;
+				regressions += slower;
+				printf("%-32s %10.2f %10.2f %+7.1f%%%s\n", result.name.c_str(), before.medianNs, result.medianNs, change, slower ? "  REGRESSION" : "");
+			}
+	return regressions;
+}
+
+//usage: Bench [-filter text] [-samples n] [-json file] [-baseline file] [-threshold percent]
+int main(int argc, char** argv) {
+	Settings settings = { 201, 0.0005, nullptr };
+	const char* jsonPath = nullptr;
+	const char* baselinePath = nullptr;
+	double threshold = 10;
+	for (int i = 1; i < argc; i++) {
+		bool hasValue = i + 1 < argc;
+		if (!strcmp(argv[i], "-filter") && hasValue)
+			settings.filter = argv[++i];
+		else if (!strcmp(argv[i], "-samples") && hasValue)
+			settings.samples = std::max(1, atoi(argv[++i]));
+		else if (!strcmp(argv[i], "-json") && hasValue)
+			jsonPath = argv[++i];
+		else if (!strcmp(argv[i], "-baseline") && hasValue)
+			baselinePath = argv[++i];
+		else if (!strcmp(argv[i], "-threshold") && hasValue)
+			threshold = atof(argv[++i]);
+		else {
+			printf("usage: %s [-filter text] [-samples n] [-json file] [-baseline file] [-threshold percent]\n", argv[0]);
+			return 1;
+		}
+	}
+
+	std::vector<Result> baseline;
+	if (baselinePath && !ReadJson(baselinePath, baseline)) {
+		printf("can't read baseline %s\n", baselinePath);
+		return 1;
+	}
+
+	printf("%-32s %10s %10s %10s %10s\n", "benchmark", "median ns", "p99 ns", "min ns", "cycles");
+	std::vector<Result> results;
+	RunAll(settings, results);
+	if (!settings.filter || strstr("hash collisions", settings.filter))
+		HashReport(200000);
+	bool masksDiffer = false;
+	if (!settings.filter || strstr("drop mask check", settings.filter))
+		masksDiffer = DropMaskReport(20000) > 0;
+	bool batchDiffers = false;
+	if (!settings.filter || strstr("batch check", settings.filter))
+		batchDiffers = BatchReport<64>(20000) + BatchDropReport(20000) > 0;
+	bool tableWrong = false;
+	if (!settings.filter || strstr("transposition stress", settings.filter))
+		tableWrong = TranspositionReport(8, 1 << 20) > 0;
+	if (jsonPath)
+		WriteJson(jsonPath, results);
+	if (baselinePath && Compare(results, baseline, threshold) > 0)
+		return 1;
+	return masksDiffer || batchDiffers || tableWrong ? 1 : 0;
+}
@@ -0,0 +1,232 @@
+#include <MoveGen.h>
+#include <ThreadPool.h>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <unordered_set>
+#include <vector>
+
+typedef Grid<10, 20> Board;
+
+const int maxDepth = 8;
+//letters for the piece types in pieceTable order
+const char pieceLetters[] = "TISZOJL";
+
+//a start board, drawn top row first with # for a block, and the pieces dealt onto it
+struct Position {
+	const char* name;
+	const char* rows[8];
+	const char* pieces;
+	//nodes at depth 1, 2, 3... with every board counted, then with each distinct board counted once
+	long long nodes[4];
+	long long unique[4];
+};
+
+//the counts were checked against a plain search that tests and clears one cell at a time,
+//so a change to ConflictingBlocks, MoveGen or DoRemoval that breaks them shows up here
+const Position positions[] = {
+	{ "empty", {}, "TISZOJL",
+		{ 34, 596, 10577, 192807 }, { 34, 596, 10577, 192728 } },
+	{ "tucks", {
+		"#.......##",
+		"##.#...###",
+		"####.#####",
+		"#########." }, "ITLJ",
+		{ 17, 590, 20902, 765600 }, { 17, 590, 20897, 763066 } },
+	{ "clears", {
+		"#########.",
+		"#########.",
+		"#########.",
+		"##.######.",
+		"#.#######." }, "IOTL",
+		{ 17, 153, 5260, 187558 }, { 17, 153, 5260, 187381 } },
+};
+
+Board MakeBoard(const Position& position) {
+	Board board;
+	int height = 0;
+	while (height < 8 && position.rows[height])
+		height++;
+	for (int i = 0; i < height; i++)
+		for (int x = 0; x < Board::width && position.rows[i][x]; x++)
+			if (position.rows[i][x] == '#')
+				board.Add(ivec2(x, height - 1 - i), 1);
+	return board;
+}
+
+bool ParsePieces(const char* letters, std::vector<int>& pieces) {
+	pieces.clear();
+	for (const char* c = letters; *c; c++) {
+		const char* found = strchr(pieceLetters, *c);
+		if (!found)
+			return false;
+		pieces.push_back(int(found - pieceLetters));
+	}
+	return !pieces.empty();
+}
+
+//the board after the piece locks at placement i, false if that loses the game
+bool Play(const Board& board, const MoveGen<Board>& gen, int i, Board& next) {
+	FallingPiece placed = gen.Placed(i);
+	if (placed.hasLoss(board))
+		return false;
+	next = board;
+	placed.AddToGrid(next);
+	next.DoRemoval();
+	return true;
+}
+
+//adds the boards reachable at each depth below this one into nodes, gens holds a generator per depth
+void Walk(const Board& board, const std::vector<int>& pieces, int depth, int maxDepth, MoveGen<Board>* gens, long long* nodes) {
+	MoveGen<Board>& gen = gens[depth];
+	int count = gen.Generate(board, FallingPiece(pieces[depth % pieces.size()], Board::SpawnPosition()));
+	for (int i = 0; i < count; i++) {
+		Board next;
+		if (!Play(board, gen, i, next))
+			continue;
+		nodes[depth]++;
+		if (depth + 1 < maxDepth)
+			Walk(next, pieces, depth + 1, maxDepth, gens, nodes);
+	}
+}
+
+//splits the moves at the root across the pool, each worker keeps its own counts
+void Perft(ThreadPool& pool, const Board& board, const std::vector<int>& pieces, int depth, long long* nodes) {
+	struct PaddedCounts {
+		long long nodes[maxDepth];
+		char pad[64];
+	};
+	std::vector<PaddedCounts> perThread(pool.size(), PaddedCounts());
+	std::vector<std::vector<MoveGen<Board>>> gens(pool.size());
+	MoveGen<Board> root;
+	int count = root.Generate(board, FallingPiece(pieces[0], Board::SpawnPosition()));
+	pool.ParallelFor(count, [&](int i, int thread) {
+		Board next;
+		if (!Play(board, root, i, next))
+			return;
+		long long* counts = perThread[thread].nodes;
+		counts[0]++;
+		if (gens[thread].empty())
+			gens[thread].resize(maxDepth);
+		if (depth > 1)
+			Walk(next, pieces, 1, depth, gens[thread].data(), counts);
+	});
+	for (int d = 0; d < depth; d++) {
+		nodes[d] = 0;
+		for (const PaddedCounts& counts : perThread)
+			nodes[d] += counts.nodes[d];
+	}
+}
+
+//counts each distinct board once per depth, a level at a time, boards are told apart by their hash
+void PerftUnique(const Board& board, const std::vector<int>& pieces, int depth, long long* nodes) {
+	std::vector<Board> level(1, board), next;
+	MoveGen<Board> gen;
+	for (int d = 0; d < depth; d++) {
+		std::unordered_set<uint64_t> seen;
+		next.clear();
+		for (const Board& from : level) {
+			int count = gen.Generate(from, FallingPiece(pieces[d % pieces.size()], Board::SpawnPosition()));
+			for (int i = 0; i < count; i++) {
+				Board played;
+				if (Play(from, gen, i, played) && seen.insert(played.hash()).second)
+					next.push_back(played);
+			}
+		}
+		nodes[d] = (long long)next.size();
+		level.swap(next);
+	}
+}
+
+double Run(ThreadPool& pool, const Board& board, const std::vector<int>& pieces, int depth, bool unique, long long* nodes) {
+	auto start = std::chrono::high_resolution_clock::now();
+	if (unique)
+		PerftUnique(board, pieces, depth, nodes);
+	else
+		Perft(pool, board, pieces, depth, nodes);
+	return ((std::chrono::duration<double>)(std::chrono::high_resolution_clock::now() - start)).count();
+}
+
+void PrintRun(const long long* nodes, int depth, double seconds) {
+	long long total = 0;
+	for (int d = 0; d < depth; d++) {
+		printf("depth %d  %lld\n", d + 1, nodes[d]);
+		total += nodes[d];
+	}
+	printf("%lld nodes in %.3f s, %.0f nodes/s\n", total, seconds, total / seconds);
+}
+
+//runs every position to the depth of its known counts, in both modes
+int Check(ThreadPool& pool) {
+	int failed = 0;
+	for (const Position& position : positions) {
+		std::vector<int> pieces;
+		ParsePieces(position.pieces, pieces);
+		for (int unique = 0; unique < 2; unique++) {
+			long long nodes[maxDepth];
+			const long long* expected = unique ? position.unique : position.nodes;
+			double seconds = Run(pool, MakeBoard(position), pieces, 4, unique != 0, nodes);
+			bool ok = true;
+			for (int d = 0; d < 4; d++)
+				ok = ok && nodes[d] == expected[d];
+			printf("%-8s %-8s %s  %.3f s\n", position.name, unique ? "unique" : "all", ok ? "ok" : "FAILED", seconds);
+			for (int d = 0; d < 4 && !ok; d++)
+				printf("  depth %d  %lld, expected %lld\n", d + 1, nodes[d], expected[d]);
+			failed += !ok;
+		}
+	}
+	return failed;
+}
+
+//usage: Perft [-position name] [-pieces letters] [-depth n] [-unique] [-threads n] [-check]
+int main(int argc, char** argv) {
+	const Position* position = &positions[0];
+	const char* letters = nullptr;
+	int depth = 4;
+	int threads = 0;
+	bool unique = false;
+	bool check = false;
+	for (int i = 1; i < argc; i++) {
+		bool hasValue = i + 1 < argc;
+		if (!strcmp(argv[i], "-position") && hasValue) {
+			const char* name = argv[++i];
+			position = nullptr;
+			for (const Position& p : positions)
+				if (!strcmp(p.name, name))
+					position = &p;
+			if (!position) {
+				printf("unknown position %s\n", name);
+				return 1;
+			}
+		}
+		else if (!strcmp(argv[i], "-pieces") && hasValue)
+			letters = argv[++i];
+		else if (!strcmp(argv[i], "-depth") && hasValue)
+			depth = atoi(argv[++i]);
+		else if (!strcmp(argv[i], "-threads") && hasValue)
+			threads = atoi(argv[++i]);
+		else if (!strcmp(argv[i], "-unique"))
+			unique = true;
+		else if (!strcmp(argv[i], "-check"))
+			check = true;
+		else {
+			printf("usage: %s [-position name] [-pieces %s] [-depth 1-%d] [-unique] [-threads n] [-check]\n", argv[0], pieceLetters, maxDepth);
+			return 1;
+		}
+	}
+
+	ThreadPool pool(threads);
+	if (check)
+		return Check(pool) ? 1 : 0;
+
+	std::vector<int> pieces;
+	if (!ParsePieces(letters ? letters : position->pieces, pieces) || depth < 1 || depth > maxDepth) {
+		printf("pieces are letters from %s and depth is 1 to %d\n", pieceLetters, maxDepth);
+		return 1;
+	}
+	long long nodes[maxDepth];
+	double seconds = Run(pool, MakeBoard(*position), pieces, depth, unique, nodes);
+	PrintRun(nodes, depth, seconds);
+	return 0;
+}
@@ -0,0 +1,155 @@
+#include <SelfPlay.h>
+#include <BeamSearch.h>
+#include <Mcts.h>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+typedef Grid<10, 20> Board;
+
+void PrintStats(const SelfPlayStats& stats, double seconds) {
+	printf("games %lld  lines %lld  pieces %lld  ticks %lld\n", stats.games, stats.lines, stats.pieces, stats.ticks);
+	printf("%.3f s  %.0f games/s  %.0f ticks/s\n", seconds, stats.games / seconds, stats.ticks / seconds);
+	printf("pieces per game:\n");
+	for (int i = 0; i < SelfPlayStats::histogramSize; i++)
+		if (stats.lengthHistogram[i])
+			printf("  [%d, %d)  %lld\n", i ? 1 << i : 0, 2 << i, stats.lengthHistogram[i]);
+}
+
+double TimeRun(int threads, uint64_t seed, int games, long long maxTicks, RandomizerType randomizer, bool bot, SelfPlayStats& stats) {
+	ThreadPool pool(threads);
+	auto start = std::chrono::high_resolution_clock::now();
+	if (bot)
+		stats = RunSelfPlay<Board, BotPlayer<Board>>(pool, seed, games, maxTicks, randomizer);
+	else
+		stats = RunSelfPlay<Board>(pool, seed, games, maxTicks, randomizer);
+	return ((std::chrono::duration<double>)(std::chrono::high_resolution_clock::now() - start)).count();
+}
+
+//plays games one after another with the beam search using every thread, printing what each move's search did
+int RunBeam(int threads, uint64_t seed, int games, int maxPieces, int depth, int width, RandomizerType randomizer) {
+	ThreadPool pool(threads);
+	BeamSearch<Board> beam(pool, depth, width);
+	long long totalNodes = 0;
+	double totalSeconds = 0;
+	for (int g = 0; g < games; g++) {
+		Game<Board> game(seed + uint64_t(g), randomizer);
+		while (game.pieces < maxPieces && beam.Play(game)) {
+			const BeamStats& stats = beam.stats;
+			printf("game %d move %d  depth %d  width %d  beam %d  duplicates %d  nodes %lld  %.0f us  %.0f nodes/s\n", g, game.pieces,
+				stats.depth, stats.width, stats.beam, stats.duplicates, stats.nodes, stats.seconds * 1e6, stats.nodesPerSecond());
+			totalNodes += stats.nodes;
+			totalSeconds += stats.seconds;
+		}
+		printf("game %d  lines %d  pieces %d%s\n", g, game.lines, game.pieces, game.lost ? "  lost" : "");
+	}
+	printf("%lld nodes in %.3f s searching, %.0f nodes/s on %d threads\n", totalNodes, totalSeconds, totalSeconds > 0 ? totalNodes / totalSeconds : 0, pool.size());
+	return 0;
+}
+
+//plays games one after another with the tree search using every thread for microseconds a move, printing what each move's search did
+int RunMcts(int threads, uint64_t seed, int games, int maxPieces, long long microseconds, int preview, RandomizerType randomizer) {
+	ThreadPool pool(threads);
+	std::unique_ptr<Mcts<Board>> mcts(new Mcts<Board>(pool, microseconds * 1e-6));
+	mcts->preview = preview;
+	long long totalIterations = 0;
+	double totalSeconds = 0;
+	for (int g = 0; g < games; g++) {
+		Game<Board> game(seed + uint64_t(g), randomizer);
+		while (game.pieces < maxPieces && mcts->Play(game)) {
+			const MctsStats& stats = mcts->stats;
+			printf("game %d move %d  iterations %lld  nodes %d  reused %d  depth %d  %.0f us  %.0f iterations/s\n", g, game.pieces,
+				stats.iterations, stats.nodes, stats.reused, stats.depth, stats.seconds * 1e6, stats.iterationsPerSecond());
+			totalIterations += stats.iterations;
+			totalSeconds += stats.seconds;
+		}
+		printf("game %d  lines %d  pieces %d%s\n", g, game.lines, game.pieces, game.lost ? "  lost" : "");
+	}
+	printf("%lld iterations in %.3f s searching, %.0f iterations/s on %d threads\n", totalIterations, totalSeconds,
+		totalSeconds > 0 ? totalIterations / totalSeconds : 0, pool.size());
+	return 0;
+}
+
+//usage: SelfPlay [-games n] [-threads n] [-seed n] [-maxTicks n] [-bag] [-history] [-bot] [-scaling]
+//                [-beam width] [-depth n] [-mcts microseconds] [-preview n] [-maxPieces n]
+//-scaling plays the same games on 1 thread, then 2, 4 and so on up to -threads or every core, printing the speedup and
+//efficiency of each and failing if any totals differ from the single thread's, so it has to be run on the machine being
+//measured, make scaling in this directory runs it over enough games to time, add -bot for games of very uneven length
+int main(int argc, char** argv) {
+	int games = 10000;
+	int threads = 0;
+	uint64_t seed = 1;
+	long long maxTicks = 1000000;
+	RandomizerType randomizer = RandomizerType::Pure;
+	bool bot = false;
+	int beamWidth = 0;
+	int depth = 3;
+	long long mctsMicroseconds = 0;
+	int preview = PieceQueue::previewSize;
+	int maxPieces = 1000;
+	bool scaling = false;
+	for (int i = 1; i < argc; i++) {
+		bool hasValue = i + 1 < argc;
+		if (!strcmp(argv[i], "-games") && hasValue)
+			games = atoi(argv[++i]);
+		else if (!strcmp(argv[i], "-threads") && hasValue)
+			threads = atoi(argv[++i]);
+		else if (!strcmp(argv[i], "-seed") && hasValue)
+			seed = strtoull(argv[++i], nullptr, 10);
+		else if (!strcmp(argv[i], "-maxTicks") && hasValue)
+			maxTicks = atoll(argv[++i]);
+		else if (!strcmp(argv[i], "-bag"))
+			randomizer = RandomizerType::Bag;
+		else if (!strcmp(argv[i], "-history"))
+			randomizer = RandomizerType::History;
+		else if (!strcmp(argv[i], "-beam") && hasValue)
+			beamWidth = atoi(argv[++i]);
+		else if (!strcmp(argv[i], "-depth") && hasValue)
+			depth = atoi(argv[++i]);
+		else if (!strcmp(argv[i], "-mcts") && hasValue)
+			mctsMicroseconds = atoll(argv[++i]);
+		else if (!strcmp(argv[i], "-preview") && hasValue)
+			preview = atoi(argv[++i]);
+		else if (!strcmp(argv[i], "-maxPieces") && hasValue)
+			maxPieces = atoi(argv[++i]);
+		else if (!strcmp(argv[i], "-bot"))
+			bot = true;
+		else if (!strcmp(argv[i], "-scaling"))
+			scaling = true;
+		else {
+			printf("usage: %s [-games n] [-threads n] [-seed n] [-maxTicks n] [-bag] [-history] [-bot] [-scaling]\n"
+				"       [-beam width] [-depth n] [-mcts microseconds] [-preview n] [-maxPieces n]\n", argv[0]);
+			return 1;
+		}
+	}
+
+	if (beamWidth > 0)
+		return RunBeam(threads, seed, games, maxPieces, depth, beamWidth, randomizer);
+	if (mctsMicroseconds > 0)
+		return RunMcts(threads, seed, games, maxPieces, mctsMicroseconds, preview, randomizer);
+
+	if (!scaling) {
+		SelfPlayStats stats;
+		double seconds = TimeRun(threads, seed, games, maxTicks, randomizer, bot, stats);
+		PrintStats(stats, seconds);
+		return 0;
+	}
+
+	//doubles the thread count up to the whole machine, the totals have to match the single thread run exactly
+	int most = threads > 0 ? threads : ThreadPool().size();
+	SelfPlayStats single;
+	double baseline = TimeRun(1, seed, games, maxTicks, randomizer, bot, single);
+	printf("threads  seconds  speedup  efficiency\n");
+	printf("%7d  %7.3f  %7.2f  %9.0f%%\n", 1, baseline, 1.0, 100.0);
+	for (int n = 2; n <= most; n = n * 2 > most && n < most ? most : n * 2) {
+		SelfPlayStats stats;
+		double seconds = TimeRun(n, seed, games, maxTicks, randomizer, bot, stats);
+		printf("%7d  %7.3f  %7.2f  %9.0f%%\n", n, seconds, baseline / seconds, 100 * baseline / seconds / n);
+		if (stats.lines != single.lines || stats.pieces != single.pieces || stats.ticks != single.ticks) {
+			printf("results with %d threads differ from one thread\n", n);
+			return 1;
+		}
+	}
+	return 0;
+}
@@ -0,0 +1,119 @@
+#pragma once
+#include <Mcts.h>
+#include <atomic>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+//runs the tree search on a thread of its own so a frame never waits for it
+//Submit hands over a copy of the game and returns straight away, the search goes on in slices of sliceSeconds and after
+//each one publishes the placement it likes best so far into one atomic word, tagged with the generation of the game it is for,
+//so a reader can never see half an answer or an answer for a position that has gone
+//a Submit for a new position bumps the generation, which the search checks between slices, so a stale one stops within a slice
+template<class GridType>
+struct AsyncAi {
+	//threads 0 leaves a core free for the thread that submits and renders
+	AsyncAi(int threads = 0, double sliceSeconds = 0.002, double maxSeconds = 1.0)
+		: maxSeconds(maxSeconds), pool(threads > 0 ? threads : std::max(1, int(std::thread::hardware_concurrency()) - 1)),
+		mcts(new Mcts<GridType>(pool, sliceSeconds)), snapshot(0), pending(false), stopping(false), generation(0), result(0),
+		submitted(0, GridType::SpawnPosition()), submittedPieces(-1), submittedHash(0) {
+		thread = std::thread([this] { Work(); });
+	}
+
+	~AsyncAi() {
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			stopping = true;
+			generation++;
+		}
+		wake.notify_one();
+		thread.join();
+	}
+
+	//starts searching game and drops whatever was being searched, unless it is the position already submitted,
+	//so it can be called every frame: moving the piece around doesn't start again, a new piece or board does
+	void Submit(const Game<GridType>& game) {
+		if (game.pieces == submittedPieces && game.grid.hash() == submittedHash && game.piece.type == submitted.type)
+			return;
+		submitted = game.piece;
+		submittedPieces = game.pieces;
+		submittedHash = game.grid.hash();
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			snapshot = game;
+			pending = true;
+			generation++;
+		}
+		wake.notify_one();
+	}
+
+	//stops searching, whatever was published is stale from here on and the next Submit searches whatever it is given,
+	//call it when a new game starts, which Submit can't tell from the old one on an empty board
+	void Cancel() {
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			pending = false;
+			generation++;
+		}
+		submittedPieces = -1;
+	}
+
+	//the best placement so far for the falling piece of the game last submitted, false until the first slice is done
+	bool Suggestion(FallingPiece& placement) const {
+		uint64_t packed = result.load(std::memory_order_acquire);
+		if (!(packed & foundBit) || uint32_t(packed >> 32) != generation.load(std::memory_order_relaxed))
+			return false;
+		placement = submitted;
+		placement.rotation = int(packed >> 16 & 0xff);
+		placement.pos = ivec2(int8_t(packed >> 8), int8_t(packed));
+		return true;
+	}
+
+private:
+	static const uint64_t foundBit = uint64_t(1) << 24;
+
+	double maxSeconds;
+	ThreadPool pool;
+	std::unique_ptr<Mcts<GridType>> mcts;
+	std::thread thread;
+	std::mutex mutex;
+	std::condition_variable wake;
+	//the game the search is to start on next, and whether it has been taken yet
+	Game<GridType> snapshot;
+	bool pending;
+	bool stopping;
+	std::atomic<uint32_t> generation;
+	//the generation in the high half, then the found bit, the rotation and the position
+	std::atomic<uint64_t> result;
+	//what was last submitted, only touched by the thread that submits
+	FallingPiece submitted;
+	int submittedPieces;
+	uint64_t submittedHash;
+
+	void Work() {
+		Game<GridType> game(0);
+		while (true) {
+			uint32_t searching;
+			{
+				std::unique_lock<std::mutex> lock(mutex);
+				wake.wait(lock, [this] { return pending || stopping; });
+				if (stopping)
+					return;
+				game = snapshot;
+				pending = false;
+				searching = generation.load();
+			}
+			//one slice after another on the same position grows the same tree, until the position goes or the time is up
+			double seconds = 0;
+			while (generation.load(std::memory_order_relaxed) == searching && seconds < maxSeconds) {
+				FallingPiece best = game.piece;
+				if (!mcts->Search(game, best))
+					break;
+				seconds += mcts->stats.seconds;
+				result.store(uint64_t(searching) << 32 | foundBit | uint64_t(best.rotation & 0xff) << 16
+					| uint64_t(uint8_t(best.pos.x)) << 8 | uint8_t(best.pos.y), std::memory_order_release);
+			}
+		}
+	}
+};
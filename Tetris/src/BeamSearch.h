@@ -0,0 +1,217 @@
+#pragma once
+#include <Bot.h>
+#include <ThreadPool.h>
+#include <TranspositionTable.h>
+#include <algorithm>
+#include <chrono>
+#include <memory>
+#include <vector>
+
+//what one move's search did
+struct BeamStats {
+	int depth;
+	int width;
+	//boards kept at the last depth searched, short of width when the boards ran out or were duplicates
+	int beam;
+	//placements generated and scored
+	long long nodes;
+	int duplicates;
+	double seconds;
+
+	double nodesPerSecond() const {
+		return seconds > 0 ? nodes / seconds : 0;
+	}
+};
+
+//looks ahead over the falling piece and the preview, keeping the width best boards after each piece
+//a board's score is the lines it cleared on the way, weighted as the bot weighs them, plus the bot's score of the board
+//every board in the beam is expanded on the pool at once, each worker scoring into its own bot and candidate list,
+//which are all sized when the search is set up, so searching a move allocates nothing
+//boards reached twice in a level are dropped through a transposition table, each level being a new search of it,
+//so nothing has to clear it between levels or moves
+template<class GridType>
+struct BeamSearch {
+	int depth;
+	int width;
+	BeamStats stats;
+
+	BeamSearch(ThreadPool& pool, int depth, int width, const float* weights = defaultWeights)
+		: depth(std::max(1, std::min(depth, PieceQueue::previewSize + 1))), width(std::max(1, width)), stats(), pool(pool),
+		workers(pool.size()), table(TableMegabytes(this->width)), level(0), beamCount(0) {
+		for (Worker& worker : workers) {
+			worker.bot.reset(new Bot<GridType>(weights));
+			worker.candidates.reserve(size_t(this->width) * Bot<GridType>::maxNodes);
+		}
+		for (std::vector<Node>& beam : beams)
+			beam.resize(this->width);
+		merged.reserve(size_t(this->width) * Bot<GridType>::maxNodes);
+	}
+
+	//returns the placement of game's falling piece that leads to the best board depth pieces on,
+	//or false when every placement loses
+	bool Search(const Game<GridType>& game, FallingPiece& best) {
+		auto start = std::chrono::high_resolution_clock::now();
+		stats = BeamStats();
+		stats.width = width;
+		pieces[0] = game.piece.type;
+		for (int i = 1; i < depth; i++)
+			pieces[i] = game.queue.Peek(i - 1);
+
+		//the beam for level l is beams[l % 2], its children go in the other one
+		Node& root = beams[0][0];
+		root.grid = game.grid;
+		root.reward = 0;
+		root.score = 0;
+		root.first = game.piece;
+		beamCount = 1;
+		for (level = 0; level < depth; level++) {
+			pool.ParallelFor(beamCount, [this](int i, int thread) { Expand(i, thread); });
+			int kept = Select(beams[level % 2], beams[1 - level % 2]);
+			if (kept == 0)
+				break;
+			beamCount = kept;
+			stats.depth = level + 1;
+		}
+		stats.beam = stats.depth > 0 ? beamCount : 0;
+		stats.seconds = ((std::chrono::duration<double>)(std::chrono::high_resolution_clock::now() - start)).count();
+		if (stats.depth == 0)
+			return false;
+		//boards are kept best first
+		best = beams[stats.depth % 2][0].first;
+		return true;
+	}
+
+	//searches and locks the chosen placement, returns false once the game is lost
+	bool Play(Game<GridType>& game) {
+		FallingPiece best = game.piece;
+		if (!Search(game, best))
+			return game.Resign();
+		return game.Place(best);
+	}
+
+private:
+	struct Node {
+		GridType grid;
+		//the weighted lines cleared to get here, and that plus the score of the board
+		float reward;
+		float score;
+		//the placement of the game's falling piece this board came from
+		FallingPiece first;
+
+		Node() : reward(0), score(0), first(0, GridType::SpawnPosition()) {}
+	};
+
+	struct Candidate {
+		float score;
+		float reward;
+		//the board it came from and which of that board's placements it is, so ties sort the same on any number of threads
+		int parent;
+		int placement;
+		int8_t rotation;
+		int8_t x, y;
+	};
+
+	//a worker's bot and candidates, one per thread so expanding never shares anything but the beam it reads
+	struct Worker {
+		std::unique_ptr<Bot<GridType>> bot;
+		std::vector<Candidate> candidates;
+		long long nodes;
+		char pad[64];
+
+		Worker() : nodes(0) {}
+	};
+
+	ThreadPool& pool;
+	std::vector<Worker> workers;
+	std::vector<Node> beams[2];
+	std::vector<Candidate> merged;
+	//the boards kept this level, with the placement of the falling piece each came from
+	TranspositionTable<GridType> table;
+	int pieces[PieceQueue::previewSize + 1];
+	int level;
+	int beamCount;
+
+	//about sixteen buckets of 4 entries for every board kept, so boards of the same level seldom push each other out
+	static size_t TableMegabytes(int width) {
+		return std::max(size_t(1), size_t(width) * 16 * 64 / (1024 * 1024));
+	}
+
+	void Expand(int i, int thread) {
+		Worker& worker = workers[thread];
+		Bot<GridType>& bot = *worker.bot;
+		const Node& node = beams[level % 2][i];
+		int count = bot.Score(node.grid, Piece(node));
+		worker.nodes += count;
+		float lineWeight = bot.weights[FeatureLines];
+		for (int p = 0; p < count; p++) {
+			const typename MoveGen<GridType>::Placement& placement = bot.gen.placements[p];
+			if (bot.gen.Placed(p).hasLoss(node.grid))
+				continue;
+			Candidate candidate;
+			candidate.reward = node.reward + lineWeight * bot.features[FeatureLines][p];
+			candidate.score = node.reward + bot.scores[p];
+			candidate.parent = i;
+			candidate.placement = p;
+			candidate.rotation = int8_t(placement.rotation);
+			candidate.x = int8_t(placement.pos.x);
+			candidate.y = int8_t(placement.pos.y);
+			worker.candidates.push_back(candidate);
+		}
+	}
+
+	//keeps the best width candidates whose boards differ, best first, returns how many it kept
+	int Select(const std::vector<Node>& from, std::vector<Node>& to) {
+		merged.clear();
+		for (Worker& worker : workers) {
+			merged.insert(merged.end(), worker.candidates.begin(), worker.candidates.end());
+			worker.candidates.clear();
+			stats.nodes += worker.nodes;
+			worker.nodes = 0;
+		}
+		//which worker expanded which board depends on the threads, so the order has to be total to keep the same boards
+		auto better = [](const Candidate& a, const Candidate& b) {
+			if (a.score != b.score)
+				return a.score > b.score;
+			if (a.parent != b.parent)
+				return a.parent < b.parent;
+			return a.placement < b.placement;
+		};
+		//duplicates are rare, so sorting a few more than width is nearly always enough
+		size_t sorted = std::min(merged.size(), size_t(width) * 2);
+		std::partial_sort(merged.begin(), merged.begin() + sorted, merged.end(), better);
+
+		table.NewSearch();
+		int kept = 0;
+		for (size_t c = 0; c < merged.size() && kept < width; c++) {
+			if (c == sorted) {
+				sorted = std::min(merged.size(), sorted * 2);
+				std::partial_sort(merged.begin() + c, merged.begin() + sorted, merged.end(), better);
+			}
+			const Candidate& candidate = merged[c];
+			const Node& parent = from[candidate.parent];
+			Node& child = to[kept];
+			FallingPiece placed = Piece(parent);
+			placed.rotation = candidate.rotation;
+			placed.pos = ivec2(candidate.x, candidate.y);
+			child.grid = parent.grid;
+			placed.AddToGrid(child.grid);
+			child.grid.DoRemoval();
+			TTEntry entry;
+			if (table.Probe(child.grid.hash(), entry) && entry.current) {
+				stats.duplicates++;
+				continue;
+			}
+			child.reward = candidate.reward;
+			child.score = candidate.score;
+			child.first = level == 0 ? placed : parent.first;
+			table.Store(child.grid.hash(), child.score, level + 1, child.first.rotation, child.first.pos.x, child.first.pos.y);
+			kept++;
+		}
+		return kept;
+	}
+
+	//the first piece starts wherever the game's falling piece is, the ones from the preview start where they spawn
+	FallingPiece Piece(const Node& node) const {
+		return level == 0 ? node.first : FallingPiece(pieces[level], GridType::SpawnPosition());
+	}
+};
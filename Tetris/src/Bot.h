@@ -0,0 +1,224 @@
+#pragma once
+#include <Game.h>
+#include <MoveGen.h>
+#include <DropMask.h>
+#include <limits>
+
+//what the evaluator measures of the board a placement leaves, cleared rows already taken out
+enum Feature {
+	//the sum of the column heights
+	FeatureHeight,
+	//empty cells with a block somewhere above them
+	FeatureHoles,
+	//the sum of the height differences of neighbouring columns
+	FeatureBumpiness,
+	//the sum of how far each column is below both its neighbours, the walls are as high as the grid
+	FeatureWells,
+	//changes between empty and filled along each row with a block in it, the walls count as filled
+	FeatureRowTransitions,
+	//changes between empty and filled up each column, the floor counts as filled
+	FeatureColumnTransitions,
+	FeatureLines,
+	numOfFeatures
+};
+
+//this bot's own weights, El-Tetris' values rounded for the features the two share, but El-Tetris also weighs landing height
+//at -4.5 and sums its wells as 1 + 2 + ... + depth, where these wells are the plain depth, so this is not El-Tetris' evaluator
+//height and bumpiness are weighed 0, they are there for other weights
+const float defaultWeights[numOfFeatures] = { 0, -7.9f, 0, -3.4f, -3.2f, -9.3f, 3.4f };
+
+//scores every placement MoveGen finds for the falling piece with a weighted sum of features and plays the best,
+//either by locking it straight away or by pressing the keys that get it there one tick at a time
+template<class GridType>
+struct Bot {
+	typedef typename GridType::RowMask RowMask;
+	typedef typename MoveGen<GridType>::Placement Placement;
+	static const int maxNodes = MoveGen<GridType>::maxNodes;
+
+	MoveGen<GridType> gen;
+	float weights[numOfFeatures];
+	//one row per feature, one column per placement, so scoring them all is one loop per feature
+	float features[numOfFeatures][maxNodes];
+	float scores[maxNodes];
+	//the straight drops ScoreDrops found
+	Placement drops[4 * GridType::width];
+
+	Bot() : planned(-1), target(0, GridType::SpawnPosition()), expected(0, GridType::SpawnPosition()),
+		pathLength(0), pathAt(0), released(false) {
+		std::copy(defaultWeights, defaultWeights + numOfFeatures, weights);
+	}
+	explicit Bot(const float* weights) : Bot() {
+		std::copy(weights, weights + numOfFeatures, this->weights);
+	}
+
+	//fills scores for every placement of piece and returns how many there are
+	int Score(const GridType& grid, const FallingPiece& piece) {
+		int count = gen.Generate(grid, piece);
+		Evaluate(grid, piece.type, gen.placements, count);
+		Weigh(count);
+		return count;
+	}
+
+	//fills drops and scores with every straight drop of a piece of type from where it spawns and returns how many there are,
+	//a cheaper and weaker move list than Score's for when the bot is only guessing at how the game goes on
+	int ScoreDrops(const GridType& grid, int type) {
+		ComputeDropMask(grid, type, GridType::SpawnPosition().y, dropMask);
+		const PieceRotations& rotations = pieceTable.pieces[type];
+		int count = 0;
+		for (int r = 0; r < dropMask.count; r++)
+			for (uint64_t legal = dropMask.legal[r]; legal; legal &= legal - 1) {
+				int x = LowestBit(legal);
+				drops[count++] = { r, ivec2(x - rotations.states[r].minX, dropMask.landing[r][x] - rotations.states[r].minY) };
+			}
+		Evaluate(grid, type, drops, count);
+		Weigh(count);
+		return count;
+	}
+
+	//scores every placement of piece and returns the best one's index into gen.placements,
+	//-1 when the piece can't go anywhere without losing
+	int Choose(const GridType& grid, const FallingPiece& piece) {
+		int count = Score(grid, piece);
+		int best = -1;
+		for (int i = 0; i < count; i++)
+			if (!gen.Placed(i).hasLoss(grid) && (best < 0 || scores[i] > scores[best]))
+				best = i;
+		return best;
+	}
+
+	//works out the features of every placement of a piece of type, each one is the piece's rows ored into a copy of
+	//the board, the full rows squeezed out and one sweep down the rows with no branches on the cells
+	void Evaluate(const GridType& grid, int type, const Placement* placements, int count) {
+		RowMask rows[rowCount] = {};
+		int stackHeight = int(grid.stackHeight);
+		for (int y = 0; y < stackHeight; y++)
+			rows[y] = grid.row(y);
+		const PieceRotations& rotations = pieceTable.pieces[type];
+		for (int i = 0; i < count; i++) {
+			const PieceShape& shape = rotations.states[placements[i].rotation];
+			int x = placements[i].pos.x + shape.minX, y = placements[i].pos.y + shape.minY;
+			int top = std::max(stackHeight, y + shape.height);
+			RowMask board[rowCount];
+			std::copy(rows, rows + rowCount, board);
+			for (int r = 0; r < shape.height; r++)
+				board[y + r] |= RowMask(RowMask(shape.rows[r]) << x);
+
+			int to = 0;
+			for (int from = 0; from < top; from++) {
+				RowMask row = board[from];
+				board[to] = row;
+				to += row != GridType::fullRow;
+			}
+			features[FeatureLines][i] = float(top - to);
+			for (int y = to; y < top; y++)
+				board[y] = 0;
+			Sweep(board, to, i);
+		}
+	}
+
+	//locks the current piece of game at the best placement without going through the keys,
+	//returns false once the game is lost
+	bool Play(Game<GridType>& game) {
+		int best = Choose(game.grid, game.piece);
+		if (best < 0)
+			return game.Resign();
+		return game.Place(gen.Placed(best));
+	}
+
+	//the keys to press on the next tick to play the best placement through Game::Step, a key is let go
+	//for a tick after each press so the game sees every press, and once the piece is in place it is hard dropped
+	//the path is planned again whenever gravity moves the piece somewhere it wasn't expected
+	InputFrame Input(const Game<GridType>& game) {
+		InputFrame input;
+		if (released) {
+			released = false;
+			return input;
+		}
+		if (planned != game.pieces || !Same(game.piece, expected))
+			Plan(game);
+		Key key = pathAt < pathLength ? path[pathAt++] : KeyHardDrop;
+		if (key == KeyRotate)
+			expected.Rotate(game.grid);
+		else if (key < KeyRotate) {
+			static const ivec2 dir[3] = { {1,0},{-1,0},{0,-1} };
+			expected.Move(dir[key], game.grid);
+		}
+		input.held[key] = true;
+		released = true;
+		return input;
+	}
+
+private:
+	//the board of a placement never goes higher than the top of the highest box MoveGen searches, plus an empty row
+	static const int rowCount = MoveGen<GridType>::searchHeight + 4;
+
+	DropMask<GridType> dropMask;
+	int planned;
+	FallingPiece target;
+	FallingPiece expected;
+	Key path[maxNodes];
+	int pathLength;
+	int pathAt;
+	bool released;
+
+	void Weigh(int count) {
+		for (int i = 0; i < count; i++) {
+			scores[i] = 0;
+			for (int f = 0; f < numOfFeatures; f++)
+				scores[i] += weights[f] * features[f][i];
+		}
+	}
+
+	static bool Same(const FallingPiece& a, const FallingPiece& b) {
+		return a.type == b.type && a.rotation == b.rotation && a.pos == b.pos;
+	}
+
+	void Plan(const Game<GridType>& game) {
+		bool samePiece = planned == game.pieces;
+		planned = game.pieces;
+		expected = game.piece;
+		pathLength = pathAt = 0;
+		int found = -1;
+		//keep going for the placement already picked for this piece if it can still be reached
+		if (samePiece) {
+			int count = gen.Generate(game.grid, game.piece);
+			for (int i = 0; i < count && found < 0; i++)
+				if (Same(gen.Placed(i), target))
+					found = i;
+		}
+		if (found < 0)
+			found = Choose(game.grid, game.piece);
+		if (found < 0)
+			return;
+		target = gen.Placed(found);
+		pathLength = gen.Path(found, path);
+		//the placement is where the piece lands, so the hard drop at the end does the last moves down in one
+		while (pathLength > 0 && path[pathLength - 1] == KeyDown)
+			pathLength--;
+	}
+
+	//the column heights are counted a row at a time as the union of every row from the top down to there,
+	//so everything is a popcount of a few masks per row
+	void Sweep(const RowMask* board, int top, int i) {
+		const RowMask leftWall = 1;
+		const RowMask rightWall = RowMask(RowMask(1) << (GridType::width - 1));
+		int height = 0, holes = 0, bumpiness = 0, wells = 0, rowTransitions = 0, columnTransitions = 0;
+		RowMask covered = 0;
+		for (int y = top; y >= 0; y--) {
+			RowMask row = board[y];
+			covered |= row;
+			height += BitCount(covered);
+			holes += BitCount(covered & ~row);
+			bumpiness += BitCount((covered ^ (covered >> 1)) & LowBits<RowMask>(GridType::width - 1));
+			wells += BitCount(GridType::fullRow & ~covered & RowMask((covered << 1) | leftWall) & RowMask((covered >> 1) | rightWall));
+			rowTransitions += GridType::Transitions(row);
+			columnTransitions += BitCount(row ^ (y > 0 ? board[y - 1] : GridType::fullRow));
+		}
+		features[FeatureHeight][i] = float(height);
+		features[FeatureHoles][i] = float(holes);
+		features[FeatureBumpiness][i] = float(bumpiness);
+		features[FeatureWells][i] = float(wells);
+		features[FeatureRowTransitions][i] = float(rowTransitions);
+		features[FeatureColumnTransitions][i] = float(columnTransitions);
+	}
+};
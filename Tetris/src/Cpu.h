@@ -0,0 +1,43 @@
+#pragma once
+//what the machine the program runs on can do, so kernels for newer instruction sets can be built into every
+//x86 build and picked at run time, instead of only when the whole build targets them
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+#define TETRIS_X86 1
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+#include <immintrin.h>
+#endif
+
+//gcc and clang only take AVX2 intrinsics in functions marked for it when the build doesn't target AVX2, msvc takes them anywhere
+#if defined(TETRIS_X86) && (defined(__GNUC__) || defined(__clang__))
+#define TETRIS_AVX2 __attribute__((target("avx2")))
+#else
+#define TETRIS_AVX2
+#endif
+
+inline bool DetectAvx2() {
+#if defined(__AVX2__)
+	return true;
+#elif defined(TETRIS_X86) && defined(_MSC_VER)
+	int info[4];
+	__cpuid(info, 0);
+	if (info[0] < 7)
+		return false;
+	//the cpu has AVX and the OS saves the ymm registers on a context switch
+	__cpuid(info, 1);
+	if ((info[2] & (1 << 27)) == 0 || (info[2] & (1 << 28)) == 0 || (_xgetbv(0) & 6) != 6)
+		return false;
+	__cpuidex(info, 7, 0);
+	return (info[1] & (1 << 5)) != 0;
+#elif defined(TETRIS_X86)
+	return __builtin_cpu_supports("avx2") != 0;
+#else
+	return false;
+#endif
+}
+
+inline bool HasAvx2() {
+	static const bool avx2 = DetectAvx2();
+	return avx2;
+}
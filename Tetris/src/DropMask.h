@@ -0,0 +1,187 @@
+#pragma once
+#include <FallingPiece.h>
+#include <Cpu.h>
+#include <cstring>
+
+//every straight drop of one piece type at once, for a bot that only rotates and shifts at the top and drops
+//for each rotation, the box columns where the piece fits on the row the drop starts from,
+//and the box row it lands on from each of them
+template<class GridType>
+struct DropMask {
+	int count;
+	//bit x is set when the box fits with its left column at x on the start row
+	uint64_t legal[4];
+	//the row the bottom of the box lands on, -1 where the drop isn't legal
+	int8_t landing[4][GridType::width];
+};
+
+//a cell of the box, row and column from its bottom left, and which rotations have a block there,
+//each rotation is a 64 bit lane that is all ones when it does
+struct DropCell {
+	int row, column;
+	uint64_t lanes[4];
+};
+
+struct DropCellTable {
+	int counts[numOfBockTypes];
+	DropCell cells[numOfBockTypes][16];
+};
+
+constexpr DropCellTable MakeDropCellTable() {
+	DropCellTable table{};
+	for (int type = 0; type < numOfBockTypes; type++)
+		for (int row = 0; row < 4; row++)
+			for (int column = 0; column < 4; column++) {
+				DropCell cell{};
+				cell.row = row;
+				cell.column = column;
+				bool any = false;
+				for (int r = 0; r < pieceTable.pieces[type].count; r++)
+					if ((pieceTable.pieces[type].states[r].rows[row] >> column) & 1) {
+						cell.lanes[r] = ~uint64_t(0);
+						any = true;
+					}
+				if (any)
+					table.cells[type][table.counts[type]++] = cell;
+			}
+	return table;
+}
+
+constexpr DropCellTable dropCellTable = MakeDropCellTable();
+
+//what both versions of the sweep start from: the grid's rows unrolled with empty rows above for the top of the box,
+//the columns each rotation's box fits in and the row each rotation's drop starts on
+template<class GridType>
+struct DropSweep {
+	uint64_t rows[GridType::height + 4];
+	uint64_t inside[4];
+	int64_t start[4];
+	int top;
+
+	DropSweep(const GridType& grid, int type, int startY) : rows(), inside(), start(), top(-1) {
+		int stackHeight = int(grid.stackHeight);
+		for (int y = 0; y < stackHeight; y++)
+			rows[y] = grid.row(y);
+		const PieceRotations& rotations = pieceTable.pieces[type];
+		for (int r = 0; r < 4; r++) {
+			start[r] = -1;
+			if (r >= rotations.count)
+				continue;
+			const PieceShape& shape = rotations.states[r];
+			inside[r] = LowBits<uint64_t>(GridType::width - shape.width + 1);
+			//a drop from above the stack lands the same as one from the row just over it, so none start higher
+			start[r] = std::min(startY + shape.minY, stackHeight);
+			top = std::max(top, int(start[r]));
+		}
+	}
+};
+
+template<class GridType>
+void WriteLandings(DropMask<GridType>& mask, int r, uint64_t stopped, int y) {
+	for (; stopped; stopped &= stopped - 1)
+		mask.landing[r][LowestBit(stopped)] = int8_t(y);
+}
+
+//tests each box position with ConflictingBlocks and steps it down a row at a time, for checking the others against
+template<class GridType>
+void DropMaskReference(const GridType& grid, int type, int startY, DropMask<GridType>& mask) {
+	memset(mask.landing, -1, sizeof(mask.landing));
+	mask.count = pieceTable.pieces[type].count;
+	for (int r = 0; r < 4; r++) {
+		mask.legal[r] = 0;
+		if (r >= mask.count)
+			continue;
+		const PieceShape& shape = pieceTable.pieces[type].states[r];
+		for (int x = 0; x + shape.width <= GridType::width; x++) {
+			FallingPiece piece(type, ivec2(x - shape.minX, startY));
+			piece.rotation = r;
+			if (piece.ConflictingBlocks({ 0,0 }, grid))
+				continue;
+			while (piece.CanMoveThisWay({ 0,-1 }, grid))
+				piece.pos.y--;
+			mask.legal[r] |= uint64_t(1) << x;
+			mask.landing[r][x] = int8_t(piece.pos.y + shape.minY);
+		}
+	}
+}
+
+//sweeps down the rows once for all four rotations, a rotation's positions join on its start row
+//and each leaves the sweep on the row it first doesn't fit, landing on the row above
+//written as loops over the four lanes so the compiler can vectorise them
+template<class GridType>
+void DropMaskLanes(const GridType& grid, int type, int startY, DropMask<GridType>& mask) {
+	DropSweep<GridType> sweep(grid, type, startY);
+	memset(mask.landing, -1, sizeof(mask.landing));
+	mask.count = pieceTable.pieces[type].count;
+	const DropCell* cells = dropCellTable.cells[type];
+	int cellCount = dropCellTable.counts[type];
+	uint64_t alive[4] = {}, legal[4] = {};
+	for (int y = sweep.top; y >= 0; y--) {
+		uint64_t blocked[4] = {};
+		for (int c = 0; c < cellCount; c++) {
+			uint64_t row = sweep.rows[y + cells[c].row] >> cells[c].column;
+			for (int r = 0; r < 4; r++)
+				blocked[r] |= row & cells[c].lanes[r];
+		}
+		for (int r = 0; r < 4; r++) {
+			uint64_t fits = sweep.inside[r] & ~blocked[r];
+			uint64_t enter = y == sweep.start[r] ? fits : 0;
+			WriteLandings(mask, r, alive[r] & ~fits, y + 1);
+			alive[r] = (alive[r] & fits) | enter;
+			legal[r] |= enter;
+		}
+	}
+	for (int r = 0; r < 4; r++) {
+		WriteLandings(mask, r, alive[r], 0);
+		mask.legal[r] = legal[r];
+	}
+}
+
+#if defined(TETRIS_X86)
+//the same sweep with the four lanes in one register, only for a cpu that HasAvx2
+template<class GridType>
+TETRIS_AVX2 void DropMaskAvx2(const GridType& grid, int type, int startY, DropMask<GridType>& mask) {
+	DropSweep<GridType> sweep(grid, type, startY);
+	memset(mask.landing, -1, sizeof(mask.landing));
+	mask.count = pieceTable.pieces[type].count;
+	const DropCell* cells = dropCellTable.cells[type];
+	int cellCount = dropCellTable.counts[type];
+	__m256i inside = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(sweep.inside));
+	__m256i start = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(sweep.start));
+	__m256i alive = _mm256_setzero_si256(), legal = _mm256_setzero_si256();
+	alignas(32) uint64_t stopped[4];
+	for (int y = sweep.top; y >= 0; y--) {
+		__m256i blocked = _mm256_setzero_si256();
+		for (int c = 0; c < cellCount; c++) {
+			__m256i row = _mm256_set1_epi64x(int64_t(sweep.rows[y + cells[c].row] >> cells[c].column));
+			blocked = _mm256_or_si256(blocked, _mm256_and_si256(row, _mm256_loadu_si256(reinterpret_cast<const __m256i*>(cells[c].lanes))));
+		}
+		__m256i fits = _mm256_andnot_si256(blocked, inside);
+		__m256i enter = _mm256_and_si256(fits, _mm256_cmpeq_epi64(start, _mm256_set1_epi64x(y)));
+		__m256i left = _mm256_andnot_si256(fits, alive);
+		if (!_mm256_testz_si256(left, left)) {
+			_mm256_store_si256(reinterpret_cast<__m256i*>(stopped), left);
+			for (int r = 0; r < 4; r++)
+				WriteLandings(mask, r, stopped[r], y + 1);
+		}
+		alive = _mm256_or_si256(_mm256_and_si256(alive, fits), enter);
+		legal = _mm256_or_si256(legal, enter);
+	}
+	_mm256_store_si256(reinterpret_cast<__m256i*>(stopped), alive);
+	for (int r = 0; r < 4; r++)
+		WriteLandings(mask, r, stopped[r], 0);
+	_mm256_storeu_si256(reinterpret_cast<__m256i*>(mask.legal), legal);
+}
+#endif
+
+//startY is the piece position the drops start from, usually the spawn row
+template<class GridType>
+void ComputeDropMask(const GridType& grid, int type, int startY, DropMask<GridType>& mask) {
+#if defined(TETRIS_X86)
+	if (HasAvx2()) {
+		DropMaskAvx2(grid, type, startY, mask);
+		return;
+	}
+#endif
+	DropMaskLanes(grid, type, startY, mask);
+}
@@ -0,0 +1,115 @@
+#pragma once
+#include <Grid.h>
+#include <Pieces.h>
+
+struct FallingPiece {
+	int type;
+	int rotation;
+	ivec2 pos;
+	unsigned char colourId;
+
+	//colour 0 is empty, so by default each type gets the colour after its index
+	FallingPiece(int type, ivec2 spawn)
+		: FallingPiece(type, spawn, type + 1) {}
+	FallingPiece(int type, ivec2 spawn, unsigned char colour)
+		: type(type), rotation(0), pos(spawn), colourId(colour) {}
+
+	template<class GridType>
+	void Move(ivec2 direction, const GridType& grid) {
+		if (CanMoveThisWay(direction, grid))
+			//move all the blocks
+			pos += direction;
+	}
+
+	//one mask test per row of the piece
+	template<class GridType>
+	bool ConflictingBlocks(ivec2 direction, const GridType& grid) const {
+		typedef typename GridType::RowMask RowMask;
+		const PieceShape& shape = CurrentPiece();
+		ivec2 p = pos + direction + ivec2(shape.minX, shape.minY);
+		if (p.x < 0 || p.x + shape.width > GridType::width || p.y < 0)
+			return true;
+		//cells above the top of the grid are free
+		for (int r = 0; r < shape.height && p.y + r < GridType::height; r++)
+			if (grid.row(p.y + r) & RowMask(RowMask(shape.rows[r]) << p.x))
+				return true;
+		return false;
+	}
+
+	template<class GridType>
+	bool CanMoveThisWay(ivec2 direction, const GridType& grid) const {
+		return !ConflictingBlocks(direction, grid);
+	}
+
+	//how many rows the piece falls before it lands, worked out from the grid's column heights
+	//and the piece's bottom profile, it only steps down a row at a time when the piece is under
+	//an overhang, where the heights don't say where it stops
+	template<class GridType>
+	int dropDistance(const GridType& grid) const {
+		const PieceShape& shape = CurrentPiece();
+		ivec2 p = pos + ivec2(shape.minX, shape.minY);
+		int distance = p.y;
+		bool underStack = false;
+		for (int x = 0; x < shape.width; x++) {
+			int room = p.y + shape.bottoms[x] - grid.columnHeight(p.x + x);
+			underStack = underStack || room < 0;
+			distance = std::min(distance, room);
+		}
+		if (!underStack && !ConflictingBlocks({ 0,-distance }, grid))
+			return distance;
+		distance = 0;
+		while (CanMoveThisWay({ 0,-distance - 1 }, grid))
+			distance++;
+		return distance;
+	}
+
+	//where the piece would land if it were dropped now
+	template<class GridType>
+	FallingPiece ghost(const GridType& grid) const {
+		FallingPiece landed = *this;
+		landed.pos.y -= dropDistance(grid);
+		return landed;
+	}
+
+	template<class GridType>
+	void HardDrop(const GridType& grid) {
+		pos.y -= dropDistance(grid);
+	}
+
+	template<class GridType>
+	void Rotate(const GridType& grid) {
+		int rot = rotation;
+		rotation++;
+		if (rotation >= pieceTable.pieces[type].count)
+			rotation = 0;
+		if (ConflictingBlocks({ 0,0 }, grid))
+			rotation = rot;
+	}
+
+	template<class GridType>
+	bool hasLoss(const GridType&) const {
+		const PieceShape& shape = CurrentPiece();
+		return pos.y + shape.minY + shape.height > GridType::height;
+	}
+
+	//the piece's part of a state hash, to xor with the grid's
+	uint64_t hash() const {
+		return zobristKeys.pieces[type][rotation] ^ zobristKeys.pieceX[pos.x + positionOffset] ^ zobristKeys.pieceY[pos.y + positionOffset];
+	}
+
+	const PieceShape& CurrentPiece() const {
+		return pieceTable.pieces[type].states[rotation];
+	}
+
+	template<class GridType>
+	void AddToGrid(GridType& grid) const {
+		typedef typename GridType::RowMask RowMask;
+		const PieceShape& shape = CurrentPiece();
+		ivec2 p = pos + ivec2(shape.minX, shape.minY);
+		for (int r = 0; r < shape.height; r++)
+			if (p.y + r >= 0 && p.y + r < GridType::height)
+				grid.Add(p.y + r, RowMask(RowMask(shape.rows[r]) << p.x), colourId);
+	}
+
+
+};
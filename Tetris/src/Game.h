@@ -0,0 +1,139 @@
+#pragma once
+#include <Grid.h>
+#include <FallingPiece.h>
+#include <Random.h>
+
+//the simulation always advances in whole ticks, every timing below is a number of ticks
+const int ticksPerSecond = 60;
+const int gravityTicks = 18;
+//how long a piece can rest on the stack before it locks
+const int lockDelayTicks = 18;
+//holding right, left or down repeats the move after autoShiftDelay ticks and then every autoRepeatRate ticks
+const int autoShiftDelay[3] = { 6, 6, 6 };
+const int autoRepeatRate[3] = { 6, 6, 6 };
+
+enum Key {
+	KeyRight,
+	KeyLeft,
+	KeyDown,
+	KeyRotate,
+	KeyHardDrop,
+	numOfKeys
+};
+
+//the keys held down during one step
+struct InputFrame {
+	bool held[numOfKeys];
+
+	InputFrame() : held() {}
+};
+
+//everything needed to play one game, with no window attached
+template<class GridType>
+struct Game {
+	GridType grid;
+	PieceQueue queue;
+	FallingPiece piece;
+
+	int ticksSinceMovedDown;
+	int ticksOnGround;
+	int ticksHeld[numOfKeys];
+	bool lost;
+	int lines;
+	int pieces;
+	long long ticks;
+
+	Game(uint64_t seed, RandomizerType randomizer = RandomizerType::Pure)
+		: queue(seed, randomizer), piece(queue.Pop(), GridType::SpawnPosition()),
+		ticksSinceMovedDown(0), ticksOnGround(0), ticksHeld(), lost(false), lines(0), pieces(0), ticks(0) {}
+
+	//the board and the falling piece, timers and the queue are left out
+	uint64_t hash() const {
+		return grid.hash() ^ piece.hash();
+	}
+
+	//advances the game by one tick with the keys in input held, returns false once the game is lost
+	bool Step(const InputFrame& input) {
+		if (lost)
+			return false;
+		ticks++;
+
+		static const ivec2 dir[3] = { {1,0},{-1,0},{0,-1} };
+		for (int i = 0; i < KeyRotate; i++)
+		{
+			if (!input.held[i]) {
+				ticksHeld[i] = 0;
+				continue;
+			}
+			int held = ticksHeld[i]++;
+			//move on the tick the key goes down, then repeat once it has been held long enough
+			if (held == 0 || (held >= autoShiftDelay[i] && (held - autoShiftDelay[i]) % autoRepeatRate[i] == 0))
+				piece.Move(dir[i], grid);
+		}
+
+		if (input.held[KeyRotate]) {
+			if (ticksHeld[KeyRotate] == 0)
+				piece.Rotate(grid);
+			ticksHeld[KeyRotate]++;
+		}
+		else
+			ticksHeld[KeyRotate] = 0;
+
+		//a hard drop lands and locks the piece at once, holding the key doesn't drop the next one
+		if (input.held[KeyHardDrop]) {
+			if (ticksHeld[KeyHardDrop]++ == 0)
+				return Place(piece.ghost(grid));
+		}
+		else
+			ticksHeld[KeyHardDrop] = 0;
+
+		if (++ticksSinceMovedDown >= gravityTicks) {
+			ticksSinceMovedDown = 0;
+			piece.Move({ 0,-1 }, grid);
+		}
+
+		if (piece.CanMoveThisWay({ 0,-1 }, grid))
+			ticksOnGround = 0;
+		else if (++ticksOnGround >= lockDelayTicks) {
+			if (piece.hasLoss(grid)) {
+				lost = true;
+				return false;
+			}
+			Lock();
+		}
+
+		return true;
+	}
+
+	//locks the piece at placed straight away, for players that pick a placement rather than press keys
+	//returns false if that loses the game
+	bool Place(const FallingPiece& placed) {
+		if (lost)
+			return false;
+		piece = placed;
+		if (piece.hasLoss(grid)) {
+			lost = true;
+			return false;
+		}
+		Lock();
+		return true;
+	}
+
+	//ends the game for a player that finds no placement that doesn't lose, returns false like Place does when it loses
+	bool Resign() {
+		lost = true;
+		return false;
+	}
+
+	//puts the piece into the grid, clears any full rows and brings in the next piece
+	void Lock() {
+		piece.AddToGrid(grid);
+		pieces++;
+		typename GridType::RowSet cleared = grid.DoRemoval();
+		for (; cleared; cleared &= cleared - 1)
+			lines++;
+		piece = FallingPiece(queue.Pop(), GridType::SpawnPosition());
+		ticksSinceMovedDown = 0;
+		ticksOnGround = 0;
+	}
+};
@@ -0,0 +1,314 @@
+#pragma once
+#include <glm/glm.hpp>
+#include <Zobrist.h>
+#include <array>
+#include <algorithm>
+#include <cstdint>
+#include <cstddef>
+#include <cstdlib>
+
+typedef glm::tvec2<int, glm::precision::mediump> ivec2;
+
+//smallest unsigned integer with at least Bits bits, used for a row of the grid and for a set of rows
+template<int Bits, int Size = (Bits <= 16 ? 16 : Bits <= 32 ? 32 : 64)>
+struct MaskType;
+template<int Bits> struct MaskType<Bits, 16> { typedef uint16_t type; };
+template<int Bits> struct MaskType<Bits, 32> { typedef uint32_t type; };
+template<int Bits> struct MaskType<Bits, 64> { typedef uint64_t type; };
+
+template<class T>
+constexpr T LowBits(int count) {
+	return count >= int(sizeof(T) * 8) ? T(~T(0)) : T((T(1) << count) - 1);
+}
+
+constexpr int BitCount(uint64_t bits) {
+	bits = bits - ((bits >> 1) & 0x5555555555555555ull);
+	bits = (bits & 0x3333333333333333ull) + ((bits >> 2) & 0x3333333333333333ull);
+	bits = (bits + (bits >> 4)) & 0x0F0F0F0F0F0F0F0Full;
+	return int((bits * 0x0101010101010101ull) >> 56);
+}
+
+//index of the lowest set bit, by de Bruijn multiplication
+inline int LowestBit(uint64_t bits) {
+	static const int8_t index[64] = {
+		0, 1, 48, 2, 57, 49, 28, 3, 61, 58, 50, 42, 38, 29, 17, 4,
+		62, 55, 59, 36, 53, 51, 43, 22, 45, 39, 33, 30, 24, 18, 12, 5,
+		63, 47, 56, 27, 60, 41, 37, 16, 54, 35, 52, 21, 44, 32, 23, 11,
+		46, 26, 40, 15, 34, 20, 31, 10, 25, 14, 19, 9, 13, 8, 7, 6
+	};
+	return index[((bits & (0 - bits)) * 0x03f79d71b4cb0a89ull) >> 58];
+}
+
+template<int Width, int Height>
+struct Grid {
+	static_assert(Width > 0 && Width <= 64, "a row has to fit in a 64 bit mask");
+	static_assert(Height > 0 && Height <= 64, "the rows have to fit in a 64 bit mask");
+
+	static const int width = Width;
+	static const int height = Height;
+	typedef typename MaskType<Width>::type RowMask;
+	//bit y refers to row y
+	typedef typename MaskType<Height>::type RowSet;
+	typedef std::array<unsigned char, Width> ColourRow;
+	static const RowMask fullRow = LowBits<RowMask>(Width);
+	static const RowSet allRows = LowBits<RowSet>(Height);
+
+	//occupancy is what the game logic reads, colours are only read when rendering
+	//both are ring buffers, row y lives at index(y) so clears and garbage only move base
+	std::array<RowMask, Height> rows;
+	std::array<ColourRow, Height> colours;
+	size_t base;
+	//every row at or above stackHeight is empty, rows below it may be empty too
+	size_t stackHeight;
+	//kept up to date by every change to rows, so it never needs working out from scratch
+	uint64_t boardHash;
+
+	//the surface the evaluators read, also kept up to date by every change to rows
+	//a column's height is one above its top block, every empty cell under that is a hole
+	std::array<uint8_t, Width> heights;
+	std::array<uint8_t, Width> columnBlocks;
+	int heightSum;
+	int blockCount;
+	//the sum of the height differences of neighbouring columns
+	int totalBumpiness;
+	//the number of times each row with blocks in it changes between empty and filled, walls count as filled
+	int totalRowTransitions;
+
+	Grid() : rows(), colours(), base(0), stackHeight(0), boardHash(0),
+		heights(), columnBlocks(), heightSum(0), blockCount(0), totalBumpiness(0), totalRowTransitions(0) {}
+
+	static ivec2 SpawnPosition() {
+		return ivec2(Width / 2, Height);
+	}
+
+	size_t index(size_t y) const {
+		size_t i = base + y;
+		return i < Height ? i : i - Height;
+	}
+	RowMask row(size_t y) const {
+		return rows[index(y)];
+	}
+
+	uint64_t hash() const {
+		return boardHash;
+	}
+	//the hash the cells of mask would add in row y
+	static uint64_t RowHash(RowMask mask, size_t y) {
+		uint64_t hash = 0;
+		for (int b = 0; b < int(sizeof(RowMask)); b++)
+			hash ^= zobristKeys.rowBytes[b][(mask >> (b * 8)) & 0xFF];
+		return ZobristRotate(hash, int(y));
+	}
+
+	int columnHeight(int x) const {
+		return heights[x];
+	}
+	int columnHoles(int x) const {
+		return heights[x] - columnBlocks[x];
+	}
+	int holes() const {
+		return heightSum - blockCount;
+	}
+	int bumpiness() const {
+		return totalBumpiness;
+	}
+	int rowTransitions() const {
+		return totalRowTransitions;
+	}
+	//how far column x is below both its neighbours, the walls are as high as the grid
+	int wellDepth(int x) const {
+		int left = x > 0 ? heights[x - 1] : Height;
+		int right = x + 1 < Width ? heights[x + 1] : Height;
+		return std::max(0, std::min(left, right) - int(heights[x]));
+	}
+	static int Transitions(RowMask row) {
+		if (row == 0)
+			return 0;
+		return BitCount((row ^ (row >> 1)) & LowBits<RowMask>(Width - 1)) + !(row & 1) + !((row >> (Width - 1)) & 1);
+	}
+
+	static bool isWithinGrid(const ivec2& pos) {
+		return pos.x >= 0 && pos.y >= 0 && pos.x < Width && pos.y < Height;
+	}
+
+	bool isBlockHere(ivec2 pos) const {
+		if (!isWithinGrid(pos))
+			return true;
+		return (row(pos.y) >> pos.x) & 1;
+	}
+	void Add(ivec2 p, unsigned char colour) {
+		if (isWithinGrid(p)) {
+			size_t i = index(p.y);
+			RowMask bit = RowMask(RowMask(1) << p.x);
+			if (!(rows[i] & bit)) {
+				boardHash ^= ZobristRotate(zobristKeys.columns[p.x], p.y);
+				totalRowTransitions += Transitions(rows[i] | bit) - Transitions(rows[i]);
+				AddToColumn(p.x, p.y);
+			}
+			rows[i] |= bit;
+			colours[i][p.x] = colour;
+			stackHeight = std::max(stackHeight, size_t(p.y + 1));
+		}
+	}
+	//sets every cell of mask in row y
+	void Add(size_t y, RowMask mask, unsigned char colour) {
+		size_t i = index(y);
+		RowMask added = mask & ~rows[i];
+		boardHash ^= RowHash(added, y);
+		totalRowTransitions += Transitions(rows[i] | mask) - Transitions(rows[i]);
+		rows[i] |= mask;
+		for (size_t x = 0; x < Width; x++)
+			if ((mask >> x) & 1) {
+				colours[i][x] = colour;
+				if ((added >> x) & 1)
+					AddToColumn(int(x), int(y));
+			}
+		stackHeight = std::max(stackHeight, y + 1);
+	}
+	bool isFull(RowMask row) const {
+		return row == fullRow;
+	}
+	//ClearRow and CopyRow only move rows around, whoever calls them keeps boardHash and the surface right
+	void ClearRow(size_t y) {
+		size_t i = index(y);
+		rows[i] = 0;
+		colours[i].fill(0);
+	}
+	void CopyRow(size_t from, size_t to) {
+		rows[index(to)] = rows[index(from)];
+		colours[index(to)] = colours[index(from)];
+	}
+	//bit y is set when row y is full, written without branches so the compiler can vectorise it
+	RowSet FullRows() const {
+		RowSet full = 0;
+		for (size_t i = 0; i < Height; i++)
+			full |= RowSet(rows[i] == fullRow) << i;
+		//the scan is over storage order, rotate it so bit 0 is the bottom row
+		if (base == 0)
+			return full;
+		return ((full >> base) | (full << (Height - base))) & allRows;
+	}
+	//removes every full row in one stable pass and returns the mask of the rows that were cleared
+	//only the rows on the cheaper side of the cleared rows are moved
+	RowSet DoRemoval() {
+		RowSet cleared = FullRows();
+		if (cleared == 0)
+			return 0;
+
+		size_t count = 0, lowest = Height, highest = 0;
+		for (size_t y = 0; y < stackHeight; y++) {
+			if ((cleared >> y) & 1) {
+				count++;
+				lowest = std::min(lowest, y);
+				highest = y;
+			}
+		}
+
+		//cleared rows leave the hash, the rows between them move down by the number cleared below,
+		//so each run of rows between two cleared rows is one rotation of its hash
+		size_t below = 0;
+		uint64_t run = 0;
+		for (size_t y = lowest; y < stackHeight; y++) {
+			uint64_t hash = RowHash(row(y), y);
+			if ((cleared >> y) & 1) {
+				boardHash ^= hash ^ run ^ ZobristRotate(run, -int(below));
+				run = 0;
+				below++;
+			}
+			else
+				run ^= hash;
+		}
+		boardHash ^= run ^ ZobristRotate(run, -int(below));
+
+		if (stackHeight - lowest - 1 <= highest) {
+			//slide the rows above down onto the lowest full row
+			size_t to = lowest;
+			for (size_t from = lowest + 1; from < stackHeight; from++)
+				if (!((cleared >> from) & 1))
+					CopyRow(from, to++);
+			for (; to < stackHeight; to++)
+				ClearRow(to);
+		}
+		else {
+			//slide the rows below up onto the highest full row, then drop the bottom
+			size_t to = highest;
+			for (size_t from = highest; from-- > 0;)
+				if (!((cleared >> from) & 1))
+					CopyRow(from, to--);
+			for (size_t y = 0; y < count; y++)
+				ClearRow(y);
+			base = index(count);
+		}
+		stackHeight -= count;
+
+		//every column loses a block to each cleared row, and they are all below its top block
+		//so its height only needs looking for when its top block was in a cleared row
+		blockCount -= int(count) * Width;
+		for (int x = 0; x < Width; x++) {
+			columnBlocks[x] = uint8_t(columnBlocks[x] - count);
+			int height = heights[x];
+			if ((cleared >> (height - 1)) & 1) {
+				height -= int(count);
+				while (height > 0 && !((row(height - 1) >> x) & 1))
+					height--;
+				SetHeight(x, height);
+			}
+			else
+				SetHeight(x, height - int(count));
+		}
+		return cleared;
+	}
+	//pushes a row in from the bottom, everything else moves up by one
+	//returns false when that pushes blocks out of the top of the grid
+	bool AddGarbage(RowMask garbage, unsigned char colour) {
+		garbage &= fullRow;
+		RowMask top = row(Height - 1);
+		//every row moves up one, the top row falls out of the grid
+		boardHash = ZobristRotate(boardHash ^ RowHash(top, Height - 1), 1) ^ RowHash(garbage, 0);
+		base = index(Height - 1);
+		rows[base] = garbage;
+		for (size_t x = 0; x < Width; x++)
+			colours[base][x] = (garbage >> x) & 1 ? colour : 0;
+		stackHeight = std::min(stackHeight + 1, size_t(Height));
+
+		//the surface moves up with the rows: every column with blocks gets one higher, and a gap in the garbage under it
+		//is one more hole, which holes() picks up from the height going up without a block, an empty column only
+		//gets a height where the garbage covers it, only a column that lost its top block out of the grid is looked for
+		totalRowTransitions += Transitions(garbage) - Transitions(top);
+		for (int x = 0; x < Width; x++) {
+			int added = (garbage >> x) & 1;
+			int lostTop = (top >> x) & 1;
+			columnBlocks[x] = uint8_t(columnBlocks[x] + added - lostTop);
+			blockCount += added - lostTop;
+			int height = heights[x];
+			if (lostTop) {
+				while (height > 0 && !((row(height - 1) >> x) & 1))
+					height--;
+				SetHeight(x, height);
+			}
+			else if (height > 0 || added)
+				SetHeight(x, height + 1);
+		}
+		return top == 0;
+	}
+	void SetHeight(int x, int height) {
+		int old = heights[x];
+		heights[x] = uint8_t(height);
+		heightSum += height - old;
+		if (x > 0)
+			totalBumpiness += std::abs(height - heights[x - 1]) - std::abs(old - heights[x - 1]);
+		if (x + 1 < Width)
+			totalBumpiness += std::abs(height - heights[x + 1]) - std::abs(old - heights[x + 1]);
+	}
+	void AddToColumn(int x, int y) {
+		columnBlocks[x]++;
+		blockCount++;
+		if (y + 1 > heights[x])
+			SetHeight(x, y + 1);
+	}
+
+
+};
+
+template<int Width, int Height> const typename Grid<Width, Height>::RowMask Grid<Width, Height>::fullRow;
+template<int Width, int Height> const typename Grid<Width, Height>::RowSet Grid<Width, Height>::allRows;
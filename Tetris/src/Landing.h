@@ -0,0 +1,102 @@
+#pragma once
+#include <Grid.h>
+#include <Pieces.h>
+#include <cstring>
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define TETRIS_LANDING_SSE2
+#endif
+
+//what a straight drop needs of one rotation state: the columns its box covers and,
+//per column, how much to add to the column height so the highest sum is the landing row plus maxLift
+//lift[i] is maxLift - bottoms[i], so it is never negative and the vector version can stay unsigned
+struct DropShape {
+	int8_t minX, minY;
+	int8_t width;
+	uint8_t lift[4];
+};
+
+struct DropTable {
+	static const int maxLift = 3;
+	DropShape shapes[numOfBockTypes][4];
+	int counts[numOfBockTypes];
+};
+
+constexpr DropTable MakeDropTable() {
+	DropTable table{};
+	for (int type = 0; type < numOfBockTypes; type++) {
+		const PieceRotations& rotations = pieceTable.pieces[type];
+		table.counts[type] = rotations.count;
+		for (int r = 0; r < rotations.count; r++) {
+			const PieceShape& shape = rotations.states[r];
+			DropShape& drop = table.shapes[type][r];
+			drop.minX = int8_t(shape.minX);
+			drop.minY = int8_t(shape.minY);
+			drop.width = int8_t(shape.width);
+			for (int x = 0; x < shape.width; x++)
+				drop.lift[x] = uint8_t(DropTable::maxLift - shape.bottoms[x]);
+		}
+	}
+	return table;
+}
+
+constexpr DropTable dropTable = MakeDropTable();
+
+constexpr bool LiftsFit() {
+	for (int type = 0; type < numOfBockTypes; type++)
+		for (int r = 0; r < dropTable.counts[type]; r++)
+			for (int x = 0; x < pieceTable.pieces[type].states[r].width; x++)
+				if (pieceTable.pieces[type].states[r].bottoms[x] > DropTable::maxLift)
+					return false;
+	return true;
+}
+static_assert(LiftsFit(), "a bottom offset is more than maxLift");
+
+//the row the bottom of the box lands on when the piece drops straight down with its box's left column at x,
+//the piece has to start above the stack in every column it covers, as it does for a drop-only bot
+template<class GridType>
+int LandingRow(const GridType& grid, int type, int rotation, int x) {
+	const DropShape& drop = dropTable.shapes[type][rotation];
+	int row = 0;
+	for (int i = 0; i < drop.width; i++)
+		row = std::max(row, grid.columnHeight(x + i) + drop.lift[i]);
+	return row - DropTable::maxLift;
+}
+
+//writes the landing row for every left column of one rotation, returns how many left columns there are
+template<class GridType>
+int LandingRowsScalar(const GridType& grid, int type, int rotation, uint8_t* rows) {
+	int columns = GridType::width - dropTable.shapes[type][rotation].width + 1;
+	for (int x = 0; x < columns; x++)
+		rows[x] = uint8_t(LandingRow(grid, type, rotation, x));
+	return columns;
+}
+
+#if defined(TETRIS_LANDING_SSE2)
+//one byte per column, shifting the heights down a byte lines column x + i up under x for every x at once,
+//rows needs room for 16 entries or the grid width if that is more, the ones past the returned count are junk
+template<class GridType>
+int LandingRows(const GridType& grid, int type, int rotation, uint8_t* rows) {
+	if (GridType::width > 16)
+		return LandingRowsScalar(grid, type, rotation, rows);
+	const DropShape& drop = dropTable.shapes[type][rotation];
+	uint8_t padded[16] = {};
+	memcpy(padded, &grid.heights[0], GridType::width < 16 ? GridType::width : 16);
+	__m128i heights = _mm_loadu_si128(reinterpret_cast<const __m128i*>(padded));
+	__m128i row = _mm_add_epi8(heights, _mm_set1_epi8(char(drop.lift[0])));
+	if (drop.width > 1)
+		row = _mm_max_epu8(row, _mm_add_epi8(_mm_srli_si128(heights, 1), _mm_set1_epi8(char(drop.lift[1]))));
+	if (drop.width > 2)
+		row = _mm_max_epu8(row, _mm_add_epi8(_mm_srli_si128(heights, 2), _mm_set1_epi8(char(drop.lift[2]))));
+	if (drop.width > 3)
+		row = _mm_max_epu8(row, _mm_add_epi8(_mm_srli_si128(heights, 3), _mm_set1_epi8(char(drop.lift[3]))));
+	row = _mm_subs_epu8(row, _mm_set1_epi8(DropTable::maxLift));
+	_mm_storeu_si128(reinterpret_cast<__m128i*>(rows), row);
+	return GridType::width - drop.width + 1;
+}
+#else
+template<class GridType>
+int LandingRows(const GridType& grid, int type, int rotation, uint8_t* rows) {
+	return LandingRowsScalar(grid, type, rotation, rows);
+}
+#endif
@@ -0,0 +1,421 @@
+#pragma once
+#include <Bot.h>
+#include <ThreadPool.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <memory>
+#include <vector>
+
+//what one move's search did
+struct MctsStats {
+	long long iterations;
+	//nodes in the tree when the search stopped, and how many of those were kept from the last move's tree
+	int nodes;
+	int reused;
+	//the most pieces an iteration placed in the tree below the root
+	int depth;
+	double seconds;
+
+	double iterationsPerSecond() const {
+		return seconds > 0 ? iterations / seconds : 0;
+	}
+};
+
+//Monte Carlo tree search over placements, for when the pieces after the preview aren't known
+//a decision node is a board and the piece to place on it, its children are chance nodes, one for each of the best few
+//placements, and a chance node's children are decision nodes, one for each type the next piece could be,
+//or only the one the preview shows if the search may look that far, the others are drawn as the Pure randomizer deals them
+//an iteration walks down by UCT, expands the decision node it stops at with the bot's full move list and plays rolloutDepth
+//pieces on from there with the bot's straight drops, its value is the lines it cleared, weighted as the bot weighs them,
+//plus the bot's score of the last board, squashed into (0, 1) around a greedy rollout from the root
+//every worker of the pool grows the one tree, a visit is counted on the way down and its value only added on the way up,
+//so a path other threads are in looks like a loss until they come back and the threads spread out (virtual loss)
+//nodes come out of a pool sized up front, moving on to the next piece keeps the subtree of the placement played
+//and the piece that came and gives the rest back, so searching a move allocates nothing
+template<class GridType>
+struct Mcts {
+	//how long a move searches, counted from after the tree has moved on to the piece, a budget too small for
+	//any iteration plays the greedy rollout's first drop
+	double budgetSeconds;
+	//how many pieces of the preview the search may look at
+	int preview;
+	//placements kept at each decision node, best first by the bot's score
+	int maxChildren;
+	//pieces each rollout plays, at least one
+	int rolloutDepth;
+	float exploration;
+	//a score this far over the greedy rollout's is worth about 0.73
+	float valueScale;
+	MctsStats stats;
+
+	Mcts(ThreadPool& pool, double budgetSeconds, int capacity = 1 << 20, const float* weights = defaultWeights)
+		: budgetSeconds(budgetSeconds), preview(PieceQueue::previewSize), maxChildren(12), rolloutDepth(2), exploration(0.5f),
+		valueScale(10), stats(), pool(pool), workers(pool.size()), capacity(std::max(capacity, 64)), nodes(new Node[this->capacity]),
+		freeStack(this->capacity), freeTop(this->capacity), full(false), root(-1), played(-1), playedHash(0),
+		rootGrid(), rootPiece(0, GridType::SpawnPosition()), rootPieces(0), baseline(0) {
+		for (int i = 0; i < this->capacity; i++)
+			freeStack[i] = this->capacity - 1 - i;
+		for (size_t i = 0; i < workers.size(); i++) {
+			workers[i].bot.reset(new Bot<GridType>(weights));
+			workers[i].random.Seed(i);
+			workers[i].path.reserve(2 * maxPlies + 2);
+		}
+	}
+
+	//returns the placement of game's falling piece the search visited most, the greedy rollout's drop when no iteration
+	//fit in the budget, or false when every placement loses
+	bool Search(const Game<GridType>& game, FallingPiece& best) {
+		stats = MctsStats();
+		Reroot(game);
+		auto start = std::chrono::high_resolution_clock::now();
+		deadline = start + std::chrono::duration_cast<std::chrono::high_resolution_clock::duration>(std::chrono::duration<double>(budgetSeconds));
+		rootGrid = game.grid;
+		rootPiece = game.piece;
+		rootPieces = game.pieces;
+		int known = std::max(0, std::min(preview, int(PieceQueue::previewSize)));
+		for (int i = 0; i < known; i++)
+			pieces[i] = game.queue.Peek(i);
+		knownPieces = known;
+
+		//the greedy rollout draws its unknown pieces from its own stream so the baseline is the same whichever thread runs
+		Worker& first = workers[0];
+		Random random = first.random;
+		first.random.Seed(uint64_t(game.pieces));
+		first.grid = rootGrid;
+		float raw;
+		FallingPiece greedy = rootPiece;
+		bool greedyFound = false;
+		baseline = Rollout(first, rootPiece.type, 0, 0, raw, &greedy, &greedyFound) ? raw : 0;
+		first.random = random;
+
+		//waking the pool costs more than a tiny budget, so a search out of time by now doesn't
+		if (std::chrono::high_resolution_clock::now() < deadline)
+			pool.ParallelFor(int(workers.size()), [this](int, int thread) { Run(thread); });
+		for (Worker& worker : workers) {
+			stats.iterations += worker.iterations;
+			stats.depth = std::max(stats.depth, worker.depth);
+			worker.iterations = 0;
+			worker.depth = 0;
+		}
+		stats.nodes = capacity - freeTop.load();
+		stats.seconds = ((std::chrono::duration<double>)(std::chrono::high_resolution_clock::now() - start)).count();
+
+		played = -1;
+		int mostVisits = 0;
+		for (int c = nodes[root].firstChild; c >= 0; c = nodes[c].nextSibling) {
+			int visits = nodes[c].visits.load();
+			if (played < 0 || visits > mostVisits) {
+				played = c;
+				mostVisits = visits;
+			}
+		}
+		if (played < 0 && !greedyFound)
+			return false;
+		if (played < 0)
+			best = greedy;
+		else
+			best = Placed(rootPiece, nodes[played]);
+		GridType after = rootGrid;
+		best.AddToGrid(after);
+		after.DoRemoval();
+		playedHash = after.hash();
+		return true;
+	}
+
+	//searches and locks the chosen placement, returns false once the game is lost
+	bool Play(Game<GridType>& game) {
+		FallingPiece best = game.piece;
+		if (!Search(game, best))
+			return game.Resign();
+		return game.Place(best);
+	}
+
+private:
+	//how far down the tree an iteration goes, in pieces, before it rolls out whatever it finds
+	static const int maxPlies = 64;
+
+	enum NodeState {
+		Leaf,
+		Expanding,
+		Expanded
+	};
+
+	struct Node {
+		std::atomic<int> visits;
+		std::atomic<float> value;
+		std::atomic<int> state;
+		int firstChild;
+		int nextSibling;
+		//a decision node's piece type, and a chance node's placement of its parent's piece
+		int8_t type;
+		int8_t rotation;
+		int8_t x, y;
+	};
+
+	//a worker's bot, board and path, one per thread so iterations share nothing but the tree
+	struct Worker {
+		std::unique_ptr<Bot<GridType>> bot;
+		Random random;
+		GridType grid;
+		std::vector<int> path;
+		int order[Bot<GridType>::maxNodes];
+		long long iterations;
+		int depth;
+		char pad[64];
+
+		Worker() : iterations(0), depth(0) {}
+	};
+
+	ThreadPool& pool;
+	std::vector<Worker> workers;
+	int capacity;
+	std::unique_ptr<Node[]> nodes;
+	//the free nodes are freeStack[0, freeTop), searches only pop them and only moving on to the next piece pushes them back
+	std::vector<int> freeStack;
+	std::atomic<int> freeTop;
+	std::atomic<bool> full;
+	int root;
+	//the root's child Search picked last, and the hash of the board it leaves
+	int played;
+	uint64_t playedHash;
+	GridType rootGrid;
+	FallingPiece rootPiece;
+	int rootPieces;
+	int pieces[PieceQueue::previewSize];
+	int knownPieces;
+	float baseline;
+	std::chrono::high_resolution_clock::time_point deadline;
+
+	//takes count nodes off the free stack, the first is returned and the rest follow it as siblings, -1 when there aren't enough
+	int Allocate(int count) {
+		int top = freeTop.load();
+		do {
+			if (top < count) {
+				full = true;
+				return -1;
+			}
+		} while (!freeTop.compare_exchange_weak(top, top - count));
+		for (int i = 0; i < count; i++) {
+			Node& node = nodes[freeStack[top - count + i]];
+			node.visits.store(0, std::memory_order_relaxed);
+			node.value.store(0, std::memory_order_relaxed);
+			node.state.store(Leaf, std::memory_order_relaxed);
+			node.firstChild = -1;
+			node.nextSibling = i + 1 < count ? freeStack[top - count + i + 1] : -1;
+		}
+		return freeStack[top - count];
+	}
+
+	//gives back the subtree under index except the one under keep, the free stack past the old top is the list still to walk
+	void Free(int index, int keep) {
+		int from = freeTop.load();
+		int top = from;
+		freeStack[top++] = index;
+		for (int i = from; i < top; i++)
+			for (int c = nodes[freeStack[i]].firstChild; c >= 0; c = nodes[c].nextSibling)
+				if (c != keep)
+					freeStack[top++] = c;
+		freeTop = top;
+	}
+
+	//searching the same position again carries on with the same tree, otherwise the new root is the decision node
+	//under the placement played for the piece that came, when the game went that way
+	void Reroot(const Game<GridType>& game) {
+		if (root >= 0 && game.pieces == rootPieces && game.grid.hash() == rootGrid.hash() && game.piece.type == rootPiece.type
+			&& game.piece.rotation == rootPiece.rotation && game.piece.pos == rootPiece.pos) {
+			stats.reused = capacity - freeTop.load();
+			return;
+		}
+		int keep = -1;
+		if (root >= 0 && played >= 0 && game.grid.hash() == playedHash)
+			for (int c = nodes[played].firstChild; c >= 0; c = nodes[c].nextSibling)
+				if (nodes[c].type == game.piece.type)
+					keep = c;
+		if (root >= 0)
+			Free(root, keep);
+		full = false;
+		root = keep;
+		if (root < 0) {
+			root = Allocate(1);
+			nodes[root].type = int8_t(game.piece.type);
+		}
+		stats.reused = keep >= 0 ? capacity - freeTop.load() : 0;
+	}
+
+	void Run(int thread) {
+		Worker& worker = workers[thread];
+		while (std::chrono::high_resolution_clock::now() < deadline) {
+			Iterate(worker);
+			worker.iterations++;
+		}
+	}
+
+	void Iterate(Worker& worker) {
+		Bot<GridType>& bot = *worker.bot;
+		worker.grid = rootGrid;
+		worker.path.clear();
+		float reward = 0, raw = 0;
+		bool alive = true;
+		int node = root;
+		int type = rootPiece.type;
+		for (int ply = 0;; ply++) {
+			Visit(worker, node);
+			//a node is expanded on its first visit and rolled out from, iterations only go on through it after that
+			if (nodes[node].state.load(std::memory_order_acquire) != Expanded) {
+				Expand(worker, node, ply);
+				alive = Rollout(worker, type, ply, reward, raw);
+				break;
+			}
+			int child = Select(node);
+			if (child < 0) {
+				alive = false;
+				break;
+			}
+			Visit(worker, child);
+			FallingPiece placed = Placed(node == root ? rootPiece : FallingPiece(type, GridType::SpawnPosition()), nodes[child]);
+			placed.AddToGrid(worker.grid);
+			reward += bot.weights[FeatureLines] * BitCount(uint64_t(worker.grid.DoRemoval()));
+			worker.depth = std::max(worker.depth, ply + 1);
+			type = PieceAt(worker, ply + 1);
+			node = -1;
+			if (ExpandChance(child, ply + 1))
+				for (node = nodes[child].firstChild; node >= 0 && nodes[node].type != type; node = nodes[node].nextSibling);
+			if (node < 0) {
+				alive = Rollout(worker, type, ply + 1, reward, raw);
+				break;
+			}
+		}
+		float value = alive ? 1 / (1 + std::exp((baseline - raw) / valueScale)) : 0;
+		for (int index : worker.path) {
+			std::atomic<float>& sum = nodes[index].value;
+			float old = sum.load(std::memory_order_relaxed);
+			while (!sum.compare_exchange_weak(old, old + value, std::memory_order_relaxed));
+		}
+	}
+
+	void Visit(Worker& worker, int node) {
+		worker.path.push_back(node);
+		nodes[node].visits.fetch_add(1, std::memory_order_relaxed);
+	}
+
+	//the piece placed ply pieces below the root, drawn when the search may not look that far
+	int PieceAt(Worker& worker, int ply) {
+		return ply - 1 < knownPieces ? pieces[ply - 1] : int(worker.random.Below(numOfBockTypes));
+	}
+
+	static FallingPiece Placed(FallingPiece piece, const Node& chance) {
+		piece.rotation = chance.rotation;
+		piece.pos = ivec2(chance.x, chance.y);
+		return piece;
+	}
+
+	//gives a leaf decision node its children, the best placements that don't lose, unless another thread is at it,
+	//the pool is out of nodes or the node is too deep
+	void Expand(Worker& worker, int node, int ply) {
+		int state = Leaf;
+		if (ply >= maxPlies || full.load(std::memory_order_relaxed) || !nodes[node].state.compare_exchange_strong(state, Expanding))
+			return;
+		Bot<GridType>& bot = *worker.bot;
+		FallingPiece piece = node == root ? rootPiece : FallingPiece(nodes[node].type, GridType::SpawnPosition());
+		int count = bot.Score(worker.grid, piece);
+		int kept = 0;
+		for (int i = 0; i < count; i++)
+			if (!bot.gen.Placed(i).hasLoss(worker.grid))
+				worker.order[kept++] = i;
+		int children = std::min(kept, maxChildren);
+		std::partial_sort(worker.order, worker.order + children, worker.order + kept,
+			[&bot](int a, int b) { return bot.scores[a] > bot.scores[b]; });
+		int first = -1;
+		if (children > 0 && (first = Allocate(children)) < 0) {
+			nodes[node].state.store(Leaf, std::memory_order_release);
+			return;
+		}
+		int c = first;
+		for (int i = 0; i < children; i++, c = nodes[c].nextSibling) {
+			const typename MoveGen<GridType>::Placement& placement = bot.gen.placements[worker.order[i]];
+			nodes[c].rotation = int8_t(placement.rotation);
+			nodes[c].x = int8_t(placement.pos.x);
+			nodes[c].y = int8_t(placement.pos.y);
+		}
+		nodes[node].firstChild = first;
+		nodes[node].state.store(Expanded, std::memory_order_release);
+	}
+
+	//gives a chance node a child for every type the piece placed ply pieces below the root could be,
+	//just the one when the search may see it, returns whether it has them
+	bool ExpandChance(int node, int ply) {
+		int state = nodes[node].state.load(std::memory_order_acquire);
+		if (state == Expanded)
+			return true;
+		if (state == Expanding || full.load(std::memory_order_relaxed) || !nodes[node].state.compare_exchange_strong(state, Expanding))
+			return false;
+		bool known = ply - 1 < knownPieces;
+		int first = Allocate(known ? 1 : numOfBockTypes);
+		if (first < 0) {
+			nodes[node].state.store(Leaf, std::memory_order_release);
+			return false;
+		}
+		if (known)
+			nodes[first].type = int8_t(pieces[ply - 1]);
+		else
+			for (int type = 0, c = first; type < numOfBockTypes; type++, c = nodes[c].nextSibling)
+				nodes[c].type = int8_t(type);
+		nodes[node].firstChild = first;
+		nodes[node].state.store(Expanded, std::memory_order_release);
+		return true;
+	}
+
+	//UCT, children nobody has visited go first and in the order the bot scored them
+	int Select(int node) {
+		float logVisits = std::log(float(std::max(1, nodes[node].visits.load(std::memory_order_relaxed))));
+		int best = -1;
+		float bestScore = 0;
+		for (int c = nodes[node].firstChild; c >= 0; c = nodes[c].nextSibling) {
+			int visits = nodes[c].visits.load(std::memory_order_relaxed);
+			if (visits == 0)
+				return c;
+			float score = nodes[c].value.load(std::memory_order_relaxed) / visits + exploration * std::sqrt(logVisits / visits);
+			if (best < 0 || score > bestScore) {
+				best = c;
+				bestScore = score;
+			}
+		}
+		return best;
+	}
+
+	//plays rolloutDepth pieces on the worker's board from a piece of type ply pieces below the root, each at the drop the bot
+	//scores best, raw is what the iteration is worth before squashing, returns false when a piece has nowhere to go
+	//first, when given, gets the first piece's drop and found whether it had one
+	bool Rollout(Worker& worker, int type, int ply, float reward, float& raw, FallingPiece* first = nullptr, bool* found = nullptr) {
+		Bot<GridType>& bot = *worker.bot;
+		for (int step = 0;; step++) {
+			int count = bot.ScoreDrops(worker.grid, type);
+			int best = -1;
+			for (int i = 0; i < count; i++)
+				if ((best < 0 || bot.scores[i] > bot.scores[best]) && !Dropped(type, bot.drops[i]).hasLoss(worker.grid))
+					best = i;
+			if (best < 0)
+				return false;
+			if (step == 0 && first) {
+				*first = Dropped(type, bot.drops[best]);
+				*found = true;
+			}
+			if (step + 1 >= rolloutDepth) {
+				raw = reward + bot.scores[best];
+				return true;
+			}
+			Dropped(type, bot.drops[best]).AddToGrid(worker.grid);
+			worker.grid.DoRemoval();
+			reward += bot.weights[FeatureLines] * bot.features[FeatureLines][best];
+			type = PieceAt(worker, ++ply);
+		}
+	}
+
+	static FallingPiece Dropped(int type, const typename MoveGen<GridType>::Placement& drop) {
+		FallingPiece piece(type, drop.pos);
+		piece.rotation = drop.rotation;
+		return piece;
+	}
+};
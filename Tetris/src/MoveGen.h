@@ -0,0 +1,230 @@
+#pragma once
+#include <Game.h>
+
+//finds every placement the falling piece can lock in, and the keys that get it to any one of them
+//a state is (rotation, x, y) of the piece's bounding box and each row of states is a bitmask:
+//fits holds the box positions that don't collide, reached the ones the piece can get to
+//the moves are the ones Game uses, right, left, down and rotate without kicks, and the search
+//assumes the inputs land before gravity or the lock delay get a say
+template<class GridType>
+struct MoveGen {
+	typedef typename GridType::RowMask RowMask;
+	//box rows searched, the piece can start above the grid
+	static const int searchHeight = GridType::height + 4;
+	static const int maxNodes = 4 * searchHeight * GridType::width;
+
+	struct Placement {
+		int rotation;
+		ivec2 pos;
+	};
+
+	FallingPiece start;
+	RowMask fits[4][searchHeight];
+	RowMask reached[4][searchHeight];
+	//what each row of reached was when its moves were last followed
+	RowMask spread[4][searchHeight];
+	Placement placements[maxNodes];
+	int placementCount;
+
+	MoveGen() : start(0, GridType::SpawnPosition()), placementCount(0) {}
+
+	//returns the number of placements found
+	int Generate(const GridType& grid, const FallingPiece& piece) {
+		start = piece;
+		placementCount = 0;
+		const PieceRotations& rotations = pieceTable.pieces[piece.type];
+		int count = rotations.count;
+		//the grid's ring buffer unrolled, with empty rows above it for the top of the box
+		RowMask rows[GridType::height + 4] = {};
+		int stackHeight = int(grid.stackHeight);
+		for (int y = 0; y < stackHeight; y++)
+			rows[y] = grid.row(y);
+		for (int r = 0; r < count; r++) {
+			FindFits(rows, stackHeight, rotations.states[r], fits[r]);
+			for (int y = 0; y < searchHeight; y++)
+				reached[r][y] = spread[r][y] = 0;
+		}
+		if (!Fits(piece.rotation, piece.pos))
+			return 0;
+		const PieceShape& shape = start.CurrentPiece();
+		reached[piece.rotation][piece.pos.y + shape.minY] = RowMask(RowMask(1) << (piece.pos.x + shape.minX));
+
+		//sweeps down the rows spreading sideways, down and through rotations until nothing new is reached
+		//a rotation can move the box up, then the sweep starts again from the highest row it reached
+		//it moves the box at most 3 rows, so a row that every rotation fills that far above the stack
+		//means every row under it down to that margin is filled too
+		int open = stackHeight + 3;
+		int top = piece.pos.y + shape.minY;
+		while (top >= 0) {
+			int y = top;
+			top = -1;
+			for (; y >= 0; y--) {
+				if (y > open && y + 1 < searchHeight && Filled(y + 1, count)) {
+					//the rows over open have nothing left to pass on, open still spreads into the stack
+					for (int r = 0; r < count; r++) {
+						for (int below = open; below <= y; below++)
+							reached[r][below] = spread[r][below] = fits[r][below];
+						spread[r][open] = 0;
+					}
+					y = open;
+				}
+				bool again = true;
+				while (again) {
+					again = false;
+					for (int r = 0; r < count; r++) {
+						//nothing new to pass on since the row was last spread
+						RowMask row = reached[r][y];
+						if (row == spread[r][y])
+							continue;
+						if (row != fits[r][y])
+							row = SpreadSideways(row, fits[r][y]);
+						reached[r][y] = spread[r][y] = row;
+						if (y > 0)
+							reached[r][y - 1] |= row & fits[r][y - 1];
+						if (count == 1)
+							continue;
+						int to = r + 1 < count ? r + 1 : 0;
+						int toY = y + rotations.states[to].minY - rotations.states[r].minY;
+						if (toY < 0 || toY >= searchHeight)
+							continue;
+						RowMask rotated = Shift(row, rotations.states[to].minX - rotations.states[r].minX) & fits[to][toY];
+						if (rotated & ~reached[to][toY]) {
+							reached[to][toY] |= rotated;
+							if (toY > y)
+								top = std::max(top, toY);
+							else if (toY == y && to < r)
+								again = true;
+						}
+					}
+				}
+			}
+		}
+
+		//a reached state locks when the state below it doesn't fit
+		for (int r = 0; r < count; r++)
+			for (int y = 0; y < searchHeight; y++) {
+				RowMask landed = reached[r][y] & ~(y > 0 ? fits[r][y - 1] : RowMask(0));
+				for (; landed; landed &= landed - 1) {
+					int x = LowestBit(landed);
+					placements[placementCount++] = { r, ivec2(x - rotations.states[r].minX, y - rotations.states[r].minY) };
+				}
+			}
+		return placementCount;
+	}
+
+	//writes the shortest list of keys that takes the piece from its start to placement i and returns its length,
+	//keys needs room for maxNodes keys, this searches one state at a time so only call it for the move being played
+	int Path(int i, Key* keys) {
+		ClearSearched();
+		nodeCount = 0;
+		Visit(start.rotation, start.pos, -1, numOfKeys);
+		int count = pieceTable.pieces[start.type].count;
+		static const ivec2 dir[3] = { {1,0},{-1,0},{0,-1} };
+		//nodes is also the queue, everything before head has been expanded
+		for (int head = 0; head < nodeCount; head++) {
+			Node node = nodes[head];
+			ivec2 pos(node.x, node.y);
+			if (node.rotation == placements[i].rotation && pos == placements[i].pos)
+				return WritePath(head, keys);
+			//down goes last so that of the shortest paths this finds the one that moves and turns first,
+			//and a run of downs at the end can be left to a hard drop
+			for (int k = 0; k < KeyDown; k++)
+				Visit(node.rotation, pos + dir[k], head, k);
+			if (count > 1)
+				Visit((node.rotation + 1) % count, pos, head, KeyRotate);
+			Visit(node.rotation, pos + dir[KeyDown], head, KeyDown);
+		}
+		return 0;
+	}
+
+	FallingPiece Placed(int i) const {
+		FallingPiece placed = start;
+		placed.rotation = placements[i].rotation;
+		placed.pos = placements[i].pos;
+		return placed;
+	}
+
+private:
+	struct Node {
+		int8_t rotation;
+		int8_t x, y;
+		//the node this one was reached from and the key pressed there, -1 for the start
+		int16_t parent;
+		uint8_t key;
+	};
+
+	RowMask searched[4][searchHeight];
+	Node nodes[maxNodes];
+	int nodeCount;
+
+	//one shift per cell gives every column the box can't be in on a row
+	static void FindFits(const RowMask* rows, int stackHeight, const PieceShape& shape, RowMask* rowFits) {
+		RowMask inside = LowBits<RowMask>(GridType::width - shape.width + 1);
+		for (int y = 0; y < stackHeight; y++) {
+			RowMask blocked = 0;
+			for (const Cell& cell : shape.cells)
+				blocked |= rows[y + cell.y - shape.minY] >> (cell.x - shape.minX);
+			rowFits[y] = inside & ~blocked;
+		}
+		for (int y = stackHeight; y < searchHeight; y++)
+			rowFits[y] = inside;
+	}
+
+	//every position in free that joins up with one in row through free positions, 1, 2, 4... steps at a time
+	static RowMask SpreadSideways(RowMask row, RowMask free) {
+		RowMask left = free, right = free;
+		for (int step = 1; step < GridType::width; step *= 2) {
+			row |= RowMask(left & RowMask(row << step)) | RowMask(right & RowMask(row >> step));
+			left &= RowMask(left << step);
+			right &= RowMask(right >> step);
+		}
+		return row;
+	}
+
+	bool Filled(int y, int count) const {
+		for (int r = 0; r < count; r++)
+			if (reached[r][y] != fits[r][y])
+				return false;
+		return true;
+	}
+
+	static RowMask Shift(RowMask row, int by) {
+		return by >= 0 ? RowMask(row << by) : RowMask(row >> -by);
+	}
+
+	bool Fits(int rotation, ivec2 pos) const {
+		const PieceShape& shape = pieceTable.pieces[start.type].states[rotation];
+		int x = pos.x + shape.minX, y = pos.y + shape.minY;
+		if (x < 0 || x >= GridType::width || y < 0 || y >= searchHeight)
+			return false;
+		return (fits[rotation][y] >> x) & 1;
+	}
+
+	void ClearSearched() {
+		for (int r = 0; r < 4; r++)
+			for (int y = 0; y < searchHeight; y++)
+				searched[r][y] = 0;
+	}
+
+	void Visit(int rotation, ivec2 pos, int parent, int key) {
+		if (!Fits(rotation, pos))
+			return;
+		const PieceShape& shape = pieceTable.pieces[start.type].states[rotation];
+		RowMask& seen = searched[rotation][pos.y + shape.minY];
+		RowMask bit = RowMask(RowMask(1) << (pos.x + shape.minX));
+		if (seen & bit)
+			return;
+		seen |= bit;
+		nodes[nodeCount++] = { int8_t(rotation), int8_t(pos.x), int8_t(pos.y), int16_t(parent), uint8_t(key) };
+	}
+
+	int WritePath(int node, Key* keys) const {
+		int length = 0;
+		for (int n = node; nodes[n].parent >= 0; n = nodes[n].parent)
+			length++;
+		int k = length;
+		for (int n = node; nodes[n].parent >= 0; n = nodes[n].parent)
+			keys[--k] = Key(nodes[n].key);
+		return length;
+	}
+};
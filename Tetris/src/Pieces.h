@@ -0,0 +1,156 @@
+#pragma once
+#include <cstdint>
+
+const int numOfBockTypes = 7;
+
+struct Cell {
+	int x, y;
+};
+
+//one rotation state of a piece, rows[r] has bit i set for the cell at (minX + i, minY + r)
+//bottoms[i] is the lowest r with a cell in column minX + i, the profile the piece lands on
+struct PieceShape {
+	int minX, minY;
+	int width, height;
+	uint8_t rows[4];
+	uint8_t bottoms[4];
+	Cell cells[4];
+};
+
+struct PieceRotations {
+	int count;
+	PieceShape states[4];
+};
+
+struct PieceTable {
+	PieceRotations pieces[numOfBockTypes];
+};
+
+//each piece is one shape plus the centre it rotates about, given in half cells so
+//pieces like I and O can turn about the corner between cells
+struct BaseShape {
+	Cell cells[4];
+	int centreX2, centreY2;
+};
+
+constexpr BaseShape baseShapes[numOfBockTypes] = {
+	{ { { 0,0 },{-1,0},{1,0},{0,1} }, 0, 0 },
+	{ { { 0,1 },{0,0},{0,-1},{0,-2} }, 1, -1 },
+	{ { { 0,0 },{0,1},{1,1},{-1,0} }, 0, 0 },
+	{ { { 0,0 },{1,0},{0,1},{-1,1} }, 0, 0 },
+	{ { { 0,0 },{1,0},{0,1},{1,1} }, 1, 1 },
+	{ { { 0,0 },{-1,0},{-1,1},{1,0} }, 0, 0 },
+	{ { { 0,0 },{-1,0},{1,1},{1,0} }, 0, 0 },
+};
+
+constexpr PieceShape MakeShape(const Cell (&cells)[4]) {
+	PieceShape shape{};
+	int maxX = cells[0].x, maxY = cells[0].y;
+	shape.minX = cells[0].x;
+	shape.minY = cells[0].y;
+	for (int i = 1; i < 4; i++) {
+		shape.minX = cells[i].x < shape.minX ? cells[i].x : shape.minX;
+		shape.minY = cells[i].y < shape.minY ? cells[i].y : shape.minY;
+		maxX = cells[i].x > maxX ? cells[i].x : maxX;
+		maxY = cells[i].y > maxY ? cells[i].y : maxY;
+	}
+	shape.width = maxX - shape.minX + 1;
+	shape.height = maxY - shape.minY + 1;
+	for (int i = 0; i < 4; i++) {
+		shape.cells[i] = cells[i];
+		shape.rows[cells[i].y - shape.minY] |= uint8_t(1 << (cells[i].x - shape.minX));
+	}
+	for (int x = 0; x < shape.width; x++) {
+		int r = 0;
+		while (r + 1 < shape.height && !((shape.rows[r] >> x) & 1))
+			r++;
+		shape.bottoms[x] = uint8_t(r);
+	}
+	return shape;
+}
+
+//a quarter turn clockwise about the centre of the base shape
+constexpr Cell RotateCell(Cell cell, const BaseShape& base) {
+	return { cell.y + (base.centreX2 - base.centreY2) / 2, -cell.x + (base.centreX2 + base.centreY2) / 2 };
+}
+
+//true when the two states are the same shape, wherever they sit
+constexpr bool SameShape(const PieceShape& a, const PieceShape& b) {
+	if (a.width != b.width || a.height != b.height)
+		return false;
+	for (int r = 0; r < 4; r++)
+		if (a.rows[r] != b.rows[r])
+			return false;
+	return true;
+}
+
+constexpr PieceRotations MakeRotations(const BaseShape& base) {
+	PieceRotations rotations{};
+	Cell cells[4] = { base.cells[0], base.cells[1], base.cells[2], base.cells[3] };
+	rotations.states[0] = MakeShape(cells);
+	rotations.count = 1;
+	for (int turn = 1; turn < 4; turn++) {
+		for (int i = 0; i < 4; i++)
+			cells[i] = RotateCell(cells[i], base);
+		PieceShape shape = MakeShape(cells);
+		//symmetric pieces come back to a shape they already have
+		bool seen = false;
+		for (int i = 0; i < rotations.count; i++)
+			seen = seen || SameShape(rotations.states[i], shape);
+		if (seen)
+			break;
+		rotations.states[rotations.count++] = shape;
+	}
+	return rotations;
+}
+
+constexpr PieceTable MakePieceTable() {
+	PieceTable table{};
+	for (int type = 0; type < numOfBockTypes; type++)
+		table.pieces[type] = MakeRotations(baseShapes[type]);
+	return table;
+}
+
+constexpr PieceTable pieceTable = MakePieceTable();
+
+constexpr bool CentresOnGrid() {
+	for (int type = 0; type < numOfBockTypes; type++)
+		if ((baseShapes[type].centreX2 - baseShapes[type].centreY2) % 2 != 0)
+			return false;
+	return true;
+}
+
+constexpr int CellCount(const PieceShape& shape) {
+	int count = 0;
+	for (int r = 0; r < 4; r++)
+		for (int i = 0; i < 8; i++)
+			count += (shape.rows[r] >> i) & 1;
+	return count;
+}
+
+//every state has four distinct cells and turning the last state brings the piece back to the first
+constexpr bool StatesAreValid() {
+	for (int type = 0; type < numOfBockTypes; type++) {
+		const PieceRotations& rotations = pieceTable.pieces[type];
+		for (int i = 0; i < rotations.count; i++)
+			if (CellCount(rotations.states[i]) != 4)
+				return false;
+		const PieceShape& last = rotations.states[rotations.count - 1];
+		Cell cells[4] = { last.cells[0], last.cells[1], last.cells[2], last.cells[3] };
+		for (int i = 0; i < 4; i++)
+			cells[i] = RotateCell(cells[i], baseShapes[type]);
+		if (!SameShape(MakeShape(cells), rotations.states[0]))
+			return false;
+	}
+	return true;
+}
+
+static_assert(CentresOnGrid(), "a rotation centre has to map cells onto cells");
+static_assert(pieceTable.pieces[0].count == 4, "T has four states");
+static_assert(pieceTable.pieces[1].count == 2, "I has two states");
+static_assert(pieceTable.pieces[2].count == 2, "S has two states");
+static_assert(pieceTable.pieces[3].count == 2, "Z has two states");
+static_assert(pieceTable.pieces[4].count == 1, "O has one state");
+static_assert(pieceTable.pieces[5].count == 4, "J has four states");
+static_assert(pieceTable.pieces[6].count == 4, "L has four states");
+static_assert(StatesAreValid(), "rotation states do not form a cycle");
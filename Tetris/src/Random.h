@@ -0,0 +1,125 @@
+#pragma once
+#include <Pieces.h>
+#include <cstdint>
+
+//xoshiro256** seeded through splitmix64, every game owns one so a game only depends on its seed
+struct Random {
+	uint64_t state[4];
+
+	explicit Random(uint64_t seed = 0) {
+		Seed(seed);
+	}
+
+	void Seed(uint64_t seed) {
+		for (int i = 0; i < 4; i++) {
+			seed += 0x9E3779B97F4A7C15ull;
+			uint64_t z = seed;
+			z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+			z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+			state[i] = z ^ (z >> 31);
+		}
+	}
+
+	static uint64_t RotateLeft(uint64_t x, int k) {
+		return (x << k) | (x >> (64 - k));
+	}
+
+	uint64_t Next() {
+		uint64_t result = RotateLeft(state[1] * 5, 7) * 9;
+		uint64_t t = state[1] << 17;
+		state[2] ^= state[0];
+		state[3] ^= state[1];
+		state[1] ^= state[2];
+		state[0] ^= state[3];
+		state[2] ^= t;
+		state[3] = RotateLeft(state[3], 45);
+		return result;
+	}
+
+	//in [0, bound), scales the top 32 bits instead of using % so there is no division
+	uint32_t Below(uint32_t bound) {
+		return uint32_t(((Next() >> 32) * bound) >> 32);
+	}
+};
+
+enum class RandomizerType {
+	//every piece is equally likely every time
+	Pure,
+	//deals all seven pieces in a shuffled bag before refilling it
+	Bag,
+	//rerolls pieces that are among the last four dealt, a few times at most
+	History
+};
+
+//deals the piece sequence, the next previewSize pieces can be looked at without dealing them
+struct PieceQueue {
+	static const int previewSize = 6;
+	static const int historySize = 4;
+	static const int historyRolls = 6;
+
+	RandomizerType type;
+	Random random;
+	int bag[numOfBockTypes];
+	int bagLeft;
+	int history[historySize];
+	int preview[previewSize];
+	int head;
+
+	PieceQueue(uint64_t seed = 0, RandomizerType type = RandomizerType::Pure)
+		: type(type), random(seed), bagLeft(0), head(0) {
+		//start the history full of S and Z so the first piece is never one of them
+		for (int i = 0; i < historySize; i++)
+			history[i] = i % 2 ? 3 : 2;
+		for (int i = 0; i < previewSize; i++)
+			preview[i] = Draw();
+	}
+
+	//i = 0 is the piece Pop will return next
+	int Peek(int i) const {
+		return preview[(head + i) % previewSize];
+	}
+
+	int Pop() {
+		int piece = preview[head];
+		preview[head] = Draw();
+		head = (head + 1) % previewSize;
+		return piece;
+	}
+
+private:
+	int Draw() {
+		switch (type) {
+		case RandomizerType::Bag:
+			if (bagLeft == 0) {
+				for (int i = 0; i < numOfBockTypes; i++)
+					bag[i] = i;
+				bagLeft = numOfBockTypes;
+			}
+			{
+				//take a random piece out of the bag and close the gap with the last one
+				int i = random.Below(bagLeft);
+				int piece = bag[i];
+				bag[i] = bag[--bagLeft];
+				return piece;
+			}
+		case RandomizerType::History: {
+			int piece = random.Below(numOfBockTypes);
+			for (int roll = 1; roll < historyRolls && InHistory(piece); roll++)
+				piece = random.Below(numOfBockTypes);
+			for (int i = historySize - 1; i > 0; i--)
+				history[i] = history[i - 1];
+			history[0] = piece;
+			return piece;
+		}
+		default:
+			return random.Below(numOfBockTypes);
+		}
+	}
+
+	bool InHistory(int piece) const {
+		for (int i = 0; i < historySize; i++)
+			if (history[i] == piece)
+				return true;
+		return false;
+	}
+};
@@ -0,0 +1,110 @@
+#pragma once
+#include <Game.h>
+#include <Bot.h>
+#include <ThreadPool.h>
+#include <vector>
+
+//presses random keys, each game gets its own generator so the game only depends on its seed
+struct RandomPlayer {
+	Random random;
+	int key;
+	int ticksLeft;
+
+	explicit RandomPlayer(uint64_t seed) : random(seed), key(numOfKeys), ticksLeft(0) {}
+
+	template<class GridType>
+	InputFrame Input(const Game<GridType>&) {
+		//hold a key, or nothing, for a few ticks at a time so moves and rotations actually happen
+		if (ticksLeft-- <= 0) {
+			key = random.Below(numOfKeys + 1);
+			ticksLeft = random.Below(8);
+		}
+		InputFrame input;
+		if (key < numOfKeys)
+			input.held[key] = true;
+		return input;
+	}
+};
+
+//plays the bot through the keys, as it plays in the window, the seed is unused since the bot doesn't roll dice
+template<class GridType>
+struct BotPlayer {
+	Bot<GridType> bot;
+
+	explicit BotPlayer(uint64_t) {}
+
+	InputFrame Input(const Game<GridType>& game) {
+		return bot.Input(game);
+	}
+};
+
+struct GameResult {
+	int lines;
+	int pieces;
+	long long ticks;
+};
+
+struct SelfPlayStats {
+	//games are bucketed by the number of pieces they lasted, bucket i holds [2^i, 2^(i+1))
+	static const int histogramSize = 24;
+
+	long long games;
+	long long lines;
+	long long pieces;
+	long long ticks;
+	long long lengthHistogram[histogramSize];
+
+	SelfPlayStats() : games(0), lines(0), pieces(0), ticks(0), lengthHistogram() {}
+
+	void Add(const GameResult& result) {
+		games++;
+		lines += result.lines;
+		pieces += result.pieces;
+		ticks += result.ticks;
+		int bucket = 0;
+		while (bucket + 1 < histogramSize && (2 << bucket) <= result.pieces)
+			bucket++;
+		lengthHistogram[bucket]++;
+	}
+
+	void Add(const SelfPlayStats& other) {
+		games += other.games;
+		lines += other.lines;
+		pieces += other.pieces;
+		ticks += other.ticks;
+		for (int i = 0; i < histogramSize; i++)
+			lengthHistogram[i] += other.lengthHistogram[i];
+	}
+};
+
+//plays games seeded firstSeed, firstSeed + 1, ... across the pool, each one until it is lost or runs for maxTicks
+//each worker only adds into its own stats, they are summed once every game is done, and since the
+//totals are integer sums they come out the same whatever the number of threads
+template<class GridType, class Player = RandomPlayer>
+SelfPlayStats RunSelfPlay(ThreadPool& pool, uint64_t firstSeed, int games, long long maxTicks,
+	RandomizerType randomizer = RandomizerType::Pure, std::vector<GameResult>* results = nullptr) {
+	struct PaddedStats {
+		SelfPlayStats stats;
+		char pad[64];
+	};
+	std::vector<PaddedStats> perThread(pool.size());
+	if (results)
+		results->assign(games, GameResult());
+
+	pool.ParallelFor(games, [&](int i, int thread) {
+		uint64_t seed = firstSeed + uint64_t(i);
+		Game<GridType> game(seed, randomizer);
+		//the player draws from a different stream than the piece queue
+		Player player(~seed);
+		while (game.ticks < maxTicks && game.Step(player.Input(game)));
+		GameResult result = { game.lines, game.pieces, game.ticks };
+		perThread[thread].stats.Add(result);
+		if (results)
+			(*results)[i] = result;
+	});
+
+	SelfPlayStats total;
+	for (const PaddedStats& stats : perThread)
+		total.Add(stats.stats);
+	return total;
+}
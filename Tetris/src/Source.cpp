@@ -9,22 +9,21 @@
 #include <array>
 #include <algorithm>
 #include <chrono> 
+#include <cstdint>
+#include <memory>
+#include <Game.h>
+#include <Bot.h>
+#include <AsyncAi.h>
 
 using std::string;
 
-typedef glm::tvec2<int, glm::precision::mediump> ivec2;
 using glm::vec2;
 const int gridWidth = 10;
 const int gridHeight = 20;
-const int numOfBockTypes=7;
-const float downSpeed = 0.1f;
-const float horizontalSpeed = 0.1f;
-const float speeds[3] = {horizontalSpeed, horizontalSpeed, downSpeed};
 const int blockSpeed = 30;
 const ivec2 gridSize = { gridWidth, gridHeight };
 const int blockSize = 30;
 ivec2 screenSize;
-const float blockFallSpeed = 0.3f;
 
 
 
@@ -38,15 +37,17 @@ struct Block {
 	static int offsetLocation;
 	static int colourLocation;
 	static glm::vec3 colours[UINT8_MAX];
+	static ivec2 boardSize;
 
 	unsigned char colourId;
 	Block(unsigned char colour = 0): colourId(colour) {}
 
-	static void Init() {
+	static void Init(ivec2 size) {
+		boardSize = size;
 		squareBuffer.CreateBuffer();
 		{
-			float x = 1 / (float)gridSize.x;
-			float y = 1 / (float)gridSize.y;
+			float x = 1 / (float)boardSize.x;
+			float y = 1 / (float)boardSize.y;
 			float verts[12] = { -x,-y, -x,y, x,y,
 				x,y, x,-y, -x,-y };
 			squareBuffer.SetData(verts, sizeof(verts));
@@ -91,15 +92,18 @@ struct Block {
 	}
 
 	static void Render(glm::vec2 pos, unsigned char colour) {
-		if (colour > 0) {
-			//need to convert to screen space
-			pos.x = (pos.x / (float)gridSize.x + 1 / (gridSize.x / 0.5f)) * 2 - 1;
-			pos.y = (pos.y / (float)gridSize.y + 1 / (gridSize.y / 0.5f)) * 2 - 1;
-			glUniform2fv(offsetLocation, 1, &pos[0]);
-			glUniform3fv(colourLocation, 1, &colours[colour][0]);
-			squareBuffer.Bind();
-			glDrawArrays(GL_TRIANGLES, 0, 6);
-		}
+		if (colour > 0)
+			Render(pos, colours[colour]);
+	}
+
+	static void Render(glm::vec2 pos, const glm::vec3& colour) {
+		//need to convert to screen space
+		pos.x = (pos.x / (float)boardSize.x + 1 / (boardSize.x / 0.5f)) * 2 - 1;
+		pos.y = (pos.y / (float)boardSize.y + 1 / (boardSize.y / 0.5f)) * 2 - 1;
+		glUniform2fv(offsetLocation, 1, &pos[0]);
+		glUniform3fv(colourLocation, 1, &colour[0]);
+		squareBuffer.Bind();
+		glDrawArrays(GL_TRIANGLES, 0, 6);
 	}
 
 	bool isReal() const { return colourId != 0; }
@@ -110,169 +114,43 @@ Buffer Block::squareBuffer = Buffer(GL_ARRAY_BUFFER, GL_STATIC_DRAW, false);
 int Block::offsetLocation;
 int Block::colourLocation;
 glm::vec3 Block::colours[UINT8_MAX];
+ivec2 Block::boardSize;
 
-struct Grid {
-	typedef std::vector<Block> Row;
-	std::array<Row, gridHeight> rows;
-	Grid(){
-		for (size_t i = 0; i < rows.size(); i++)
-			rows[i] = std::vector<Block>(gridWidth);
-	}
-	bool isWithinGrid(const ivec2& pos) const {
-		return pos.x >= 0 && pos.y >= 0 && pos.x < gridWidth && pos.y < gridHeight;
-	}
-
-	bool isBlockHere(ivec2 pos) const {
-		if (!isWithinGrid(pos))
-			return true;
-		return rows[pos.y][pos.x].isReal();
-	}
-	void Add(ivec2 p, unsigned char colour) {
-		if(isWithinGrid(p))
-			rows[p.y][p.x].colourId = colour;
-	}
-	void Render() {
-		for (size_t y = 0; y < rows.size(); y++)
-			for (size_t x = 0; x < rows[y].size(); x++)
-				rows[y][x].Render(glm::vec2(x, y));
-	}
-	void removeSwap(std::vector<Block>& blocks, int i) {
-		blocks[i] = blocks.back();
-		blocks.pop_back();
-	}
-	bool isFull(const Row& row) {
-		return std::all_of(row.begin(), row.end(), [](const Block& block) {return block.isReal(); });
-	}
-	void ClearRow(Row& row) {
-		memset(row.data(), 0, row.size() * sizeof(Row::value_type));
-	}
-	void DoRemoval() {
-		for (size_t i = 0; i < rows.size(); i++)
-		{
-			if (isFull(rows[i])) {
-				std::copy(rows.begin() + i+1, rows.end(), rows.begin()+i);
-				ClearRow(rows.back());
-				i--;
-			}
-		}
-	}
-
-
-};
-
-
-
-
-struct FallingPiece {
-	typedef std::vector<ivec2> Piece;
-	typedef std::vector<Piece> RotationPiece;
-	static const RotationPiece pieces[];
-
-	int rotation;
-	ivec2 pos;
-	unsigned char colourId;
-	const RotationPiece* piece;
-
-	FallingPiece(int type, unsigned char colour = rand()% (UINT8_MAX-1) + 1)
-		: colourId(colour), rotation(0), piece(&pieces[type]) {
-		pos = ivec2(gridWidth / 2, gridHeight);
-	}
-
-	void Move(ivec2 direction, const Grid& grid) {
-		if (CanMoveThisWay(direction, grid))
-			//move all the blocks
-			pos += direction;
-	}
-
-	void Render() {
-		for (auto blockPos = CurrentPiece().begin(); blockPos != CurrentPiece().end(); blockPos++) {
-					Block::Render(*blockPos + pos, colourId);
-		}
-	}
-
-	bool ConflictingBlocks(ivec2 direction, const Grid& grid) {
-		ivec2 p;
-		for (auto positions = CurrentPiece().begin();
-			positions != CurrentPiece().end(); positions++) {
-			p = *positions + direction + pos;
-			if (p.x < 0 || p.x >= gridWidth || grid.isBlockHere(p) && p.y<gridHeight || p.y == -1)
-				return true;
-		}
-		return false;
-	}
+typedef Grid<gridWidth, gridHeight> Board;
 
-	bool CanMoveThisWay(ivec2 direction, const Grid& grid) {
-		return !ConflictingBlocks(direction, grid);
+template<int Width, int Height>
+void RenderGrid(const Grid<Width, Height>& grid) {
+	for (size_t y = 0; y < grid.stackHeight; y++) {
+		size_t i = grid.index(y);
+		for (size_t x = 0; x < Width; x++)
+			if ((grid.rows[i] >> x) & 1)
+				Block::Render(glm::vec2(x, y), grid.colours[i][x]);
 	}
+}
 
-	void Rotate(const Grid& grid) {
-		int rot = rotation;
-		rotation++;
-		if (rotation >= piece->size())
-			rotation = 0;
-		if (ConflictingBlocks({ 0,0 }, grid))
-			rotation = rot;
-	}
-
-	bool hasLoss() {
-		for (auto b = CurrentPiece().begin(); b < CurrentPiece().end(); b++)
-		{
-			if (b->y + pos.y >= gridHeight)
-				return true;
-		}
-		return false;
-	}
-
-	const Piece& CurrentPiece() {
-		return (*piece)[rotation];
-	}
-
-	void AddToGrid(Grid& grid) {
-		for (auto p = CurrentPiece().begin(); p != CurrentPiece().end(); p++)
-			grid.Add(pos + *p, colourId);
-	}
-
-
-};
-
-const std::vector<std::vector<ivec2>> FallingPiece::pieces[numOfBockTypes]{
-{ 
-	{ { 0,0 },{-1,0},{1,0},{0,1} },
-	{ { 0,0 },{0,-1},{1,0},{0,1} },
-	{ { 0,0 },{-1,0},{1,0},{0,-1} },
-	{ { 0,0 },{-1,0},{0,1},{0,-1} }
-
-},{
-
-	{ { 0,1 },{0,0},{0,-1},{0,-2} },
-	{ { -1,0 },{0,0},{1,0},{2,0} },
-
-},{
+void RenderPiece(const FallingPiece& piece) {
+	for (const Cell& cell : piece.CurrentPiece().cells)
+		Block::Render(ivec2(cell.x, cell.y) + piece.pos, piece.colourId);
+}
 
-	{ { 0,0 },{0,1},{1,1},{-1,0} },
-	{ { 0,0 },{0,1},{-1,1},{-1,2} },
+//where the piece will land, its colour faded most of the way into the background
+void RenderGhost(const FallingPiece& piece, const Board& grid) {
+	FallingPiece ghost = piece.ghost(grid);
+	glm::vec3 colour = glm::mix(glm::vec3(0.5f), Block::colours[piece.colourId], 0.35f);
+	for (const Cell& cell : ghost.CurrentPiece().cells)
+		Block::Render(ivec2(cell.x, cell.y) + ghost.pos, colour);
+}
 
-},{
+//where the search would put the piece, its colour faded towards white
+void RenderSuggestion(const FallingPiece& placement) {
+	glm::vec3 colour = glm::mix(glm::vec3(1.0f), Block::colours[placement.colourId], 0.35f);
+	for (const Cell& cell : placement.CurrentPiece().cells)
+		Block::Render(ivec2(cell.x, cell.y) + placement.pos, colour);
+}
 
-	{ { 0,0 },{1,0},{0,1},{-1,1} },
-	{ { 0,0 },{0,1},{1,1},{1,2} },
-},{
 
-	{ { 0,0 },{1,0},{0,1},{1,1} },
-},{
 
-	{ { 0,0 },{-1,0},{-1,1},{1,0} },
-	{ { 0,0 },{0,1},{1,1},{0,-1} },
-	{ { 0,0 },{-1,0},{1,0},{1,-1} },
-	{ { 0,0 },{0,1},{0,-1},{-1,-1} },
-},{
 
-	{ { 0,0 },{-1,0},{1,1},{1,0} },
-	{ { 0,0 },{0,1},{1,-1},{0,-1} },
-	{ { 0,0 },{-1,0},{1,0},{-1,-1} },
-	{ { 0,0 },{0,1},{0,-1},{-1,1} },
-}
-};
 
 
 
@@ -289,82 +167,80 @@ int WinMain(HINSTANCE hInstance, HINSTANCE hPrevInstance, LPSTR lpCmdLine, int n
 	glClearColor(0.5f, 0.5f, 0.5f, 1);
 	glfwSetWindowPos(window, 0, 40);
 
-	Block::Init();
+	Block::Init(gridSize);
 
 	srand(clock());
 
-	while (true){
-
-		Grid grid = Grid();
-
-		FallingPiece piece = FallingPiece(rand() % numOfBockTypes);
+	//B hands the game to the bot and back
+	Bot<Board> bot;
+	bool botPlaying = false;
+	bool botKeyDown = false;
 
-		float timeSinceLastMovedDown = 0;
-		float timeSinceLastPressed[4];
-		bool released[4]{ 1,1,1,1 };
-		auto start = std::chrono::high_resolution_clock::now();
-		float delta = 0;
-		while (true) {
-			start = std::chrono::high_resolution_clock::now();
-			glfwWaitEventsTimeout(blockFallSpeed/30.0f);
+	//H shows where the tree search would put the piece, it searches on its own threads so frames never wait for it
+	//they are only started the first time H is pressed
+	std::unique_ptr<AsyncAi<Board>> ai;
+	bool showHint = false;
+	bool hintKeyDown = false;
 
+	while (true){
 
-			if (blockFallSpeed < timeSinceLastMovedDown) {
-				if (!piece.CanMoveThisWay({ 0,-1 }, grid)) {
-					if (piece.hasLoss())
-						break;
-					piece.AddToGrid(grid);
-					piece = FallingPiece(rand() % numOfBockTypes);
-					grid.DoRemoval();
-				}
-
-				timeSinceLastMovedDown = 0;
-				piece.Move({ 0,-1 }, grid);
+		Game<Board> game(std::chrono::high_resolution_clock::now().time_since_epoch().count());
+		//a new game can start on a position that looks like the one last submitted, an empty board with the same piece
+		if (ai)
+			ai->Cancel();
+
+		//real time is fed into the simulation a whole tick at a time, so it plays the same at any frame rate
+		const double tickLength = 1.0 / ticksPerSecond;
+		const double maxFrameTime = 0.25;
+		double accumulator = 0;
+		auto last = std::chrono::high_resolution_clock::now();
+		bool playing = true;
+		while (playing) {
+			glfwWaitEventsTimeout(tickLength);
+
+			auto now = std::chrono::high_resolution_clock::now();
+			accumulator += std::min(((std::chrono::duration<double>)(now - last)).count(), maxFrameTime);
+			last = now;
+
+			static const int keyCodes[numOfKeys] = { GLFW_KEY_RIGHT, GLFW_KEY_LEFT, GLFW_KEY_DOWN, GLFW_KEY_UP, GLFW_KEY_SPACE };
+			InputFrame input;
+			for (int i = 0; i < numOfKeys; i++)
+				input.held[i] = glfwGetKey(window, keyCodes[i]) == GLFW_PRESS;
+
+			bool botKey = glfwGetKey(window, GLFW_KEY_B) == GLFW_PRESS;
+			if (botKey && !botKeyDown)
+				botPlaying = !botPlaying;
+			botKeyDown = botKey;
+
+			bool hintKey = glfwGetKey(window, GLFW_KEY_H) == GLFW_PRESS;
+			if (hintKey && !hintKeyDown) {
+				showHint = !showHint;
+				if (showHint && !ai)
+					ai.reset(new AsyncAi<Board>());
+				if (!showHint)
+					ai->Cancel();
 			}
-			static ivec2 dir[3] = { {1,0},{-1,0},{0,-1} };
-
-			for (size_t i = 0; i < 3; i++)
-			{
-				if (glfwGetKey(window, GLFW_KEY_RIGHT+i) == GLFW_PRESS) {
-					if (released[i] == true) {
-						piece.Move(dir[i], grid); 
-					}
-					released[i] = false;
-					timeSinceLastPressed[i] += delta;
-				}
-				if (glfwGetKey(window, GLFW_KEY_RIGHT+i) == GLFW_RELEASE) {
-					released[i] = true;
-					timeSinceLastPressed[i] = 0;
-				}
-				if (!released[i]) {
-					if (timeSinceLastPressed[i] > speeds[i]) {
-						timeSinceLastPressed[i] = 0;
-						piece.Move(dir[i], grid);
-					}
-				}
-			}
-
+			hintKeyDown = hintKey;
 
-			if (glfwGetKey(window, GLFW_KEY_UP) == GLFW_PRESS) {
-				if (released[3] == true)
-					piece.Rotate(grid); 
-				released[3] = false;
-			}
+			for (; playing && accumulator >= tickLength; accumulator -= tickLength)
+				playing = game.Step(botPlaying ? bot.Input(game) : input);
 
-			if (glfwGetKey(window, GLFW_KEY_UP) == GLFW_RELEASE)
-				released[3] = true;
-			
 			if (glfwWindowShouldClose(window))		
 				return 0;
 	
+			//only a new piece or board starts the search again, and the answer is whatever it has got to so far
+			FallingPiece hint = game.piece;
+			if (showHint)
+				ai->Submit(game);
+
 			//Render blocks
-			grid.Render();
-			piece.Render();
+			RenderGrid(game.grid);
+			if (showHint && ai->Suggestion(hint))
+				RenderSuggestion(hint);
+			RenderGhost(game.piece, game.grid);
+			RenderPiece(game.piece);
 			glfwSwapBuffers(window);
 			glClear(GL_COLOR_BUFFER_BIT);
-			
-			delta = ((std::chrono::duration<double>)(std::chrono::high_resolution_clock::now() - start)).count();
-			timeSinceLastMovedDown += delta;
 		}
 	}
 	return 0;
@@ -0,0 +1,146 @@
+#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+//a fixed set of worker threads that share out loops of independent tasks
+//each worker starts with an even slice of the loop, when its slice runs out it steals half of
+//what is left of another worker's slice, so long tasks don't leave the other cores idle
+struct ThreadPool {
+	explicit ThreadPool(int threads = 0)
+		: ranges(new Range[Workers(threads)]), count(0), completed(0), generation(0), active(0), stopping(false) {
+		int n = Workers(threads);
+		for (int i = 0; i < n; i++)
+			workers.emplace_back([this, i] { Work(i); });
+	}
+
+	~ThreadPool() {
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			stopping = true;
+		}
+		wake.notify_all();
+		for (std::thread& worker : workers)
+			worker.join();
+	}
+
+	int size() const {
+		return int(workers.size());
+	}
+
+	//calls task(i, thread) for every i in [0, count) and returns once they have all finished
+	//thread is the index of the worker running it, for per thread scratch space
+	void ParallelFor(int count, std::function<void(int, int)> task) {
+		if (count <= 0)
+			return;
+		std::unique_lock<std::mutex> lock(mutex);
+		//a worker still looking for work from the last loop must not see this one half set up
+		done.wait(lock, [this] { return active == 0; });
+		this->task = std::move(task);
+		this->count = count;
+		completed = 0;
+		int n = size();
+		for (int i = 0; i < n; i++)
+			ranges[i].bounds.store(Pack(uint32_t(int64_t(count) * i / n), uint32_t(int64_t(count) * (i + 1) / n)));
+		generation++;
+		wake.notify_all();
+		done.wait(lock, [this] { return completed.load() == this->count && active == 0; });
+		this->task = nullptr;
+	}
+
+private:
+	//the slice [begin, end) a worker has left, packed into one word so it can be taken from with one compare and swap
+	struct Range {
+		std::atomic<uint64_t> bounds;
+		char pad[64 - sizeof(std::atomic<uint64_t>)];
+	};
+
+	std::vector<std::thread> workers;
+	std::unique_ptr<Range[]> ranges;
+	std::function<void(int, int)> task;
+	int count;
+	std::atomic<int> completed;
+	uint64_t generation;
+	int active;
+	bool stopping;
+	std::mutex mutex;
+	std::condition_variable wake, done;
+
+	static int Workers(int threads) {
+		if (threads > 0)
+			return threads;
+		int hardware = int(std::thread::hardware_concurrency());
+		return hardware > 0 ? hardware : 1;
+	}
+
+	static uint64_t Pack(uint32_t begin, uint32_t end) {
+		return uint64_t(begin) | uint64_t(end) << 32;
+	}
+	static uint32_t Begin(uint64_t bounds) {
+		return uint32_t(bounds);
+	}
+	static uint32_t End(uint64_t bounds) {
+		return uint32_t(bounds >> 32);
+	}
+
+	//takes the next index from the front of the worker's own slice
+	bool TakeOwn(int worker, int& index) {
+		std::atomic<uint64_t>& bounds = ranges[worker].bounds;
+		uint64_t current = bounds.load();
+		while (Begin(current) < End(current)) {
+			if (bounds.compare_exchange_weak(current, Pack(Begin(current) + 1, End(current)))) {
+				index = int(Begin(current));
+				return true;
+			}
+		}
+		return false;
+	}
+
+	//moves the back half of another worker's slice into this one's and takes its first index
+	bool Steal(int worker, int& index) {
+		int n = size();
+		for (int i = 1; i < n; i++) {
+			std::atomic<uint64_t>& victim = ranges[(worker + i) % n].bounds;
+			uint64_t current = victim.load();
+			while (Begin(current) < End(current)) {
+				uint32_t begin = Begin(current), end = End(current);
+				uint32_t middle = begin + (end - begin) / 2;
+				if (victim.compare_exchange_weak(current, Pack(begin, middle))) {
+					index = int(middle);
+					ranges[worker].bounds.store(Pack(middle + 1, end));
+					return true;
+				}
+			}
+		}
+		return false;
+	}
+
+	void Work(int worker) {
+		uint64_t seen = 0;
+		while (true) {
+			{
+				std::unique_lock<std::mutex> lock(mutex);
+				wake.wait(lock, [&] { return stopping || generation != seen; });
+				if (stopping)
+					return;
+				seen = generation;
+				active++;
+			}
+			int index;
+			while (TakeOwn(worker, index) || Steal(worker, index)) {
+				task(index, worker);
+				completed.fetch_add(1);
+			}
+			{
+				std::lock_guard<std::mutex> lock(mutex);
+				active--;
+			}
+			done.notify_all();
+		}
+	}
+};
@@ -0,0 +1,271 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+
+//what the search knows about one board, looked up by the board's hash
+struct TTEntry {
+	float score;
+	int depth;
+	//the best placement found, rotation and position of the piece
+	int rotation;
+	int x, y;
+	//stored since the last NewSearch
+	bool current;
+};
+
+//how many bits hold the numbers 0 to count - 1
+constexpr int BitsFor(int count) {
+	return count <= 1 ? 0 : 1 + BitsFor((count + 1) / 2);
+}
+
+//a fixed size hash table shared by every search thread without locks
+//buckets are one cache line of 4 entries, an entry is two words, the data and the data xored with the hash,
+//so a read that races a write just fails to match and is a miss, never a wrong entry
+//writers take an entry by swapping its key word for busy, a writer that loses the swap drops its store
+//the position fields are as wide as GridType needs
+template<class GridType>
+struct TranspositionTable {
+	struct Stats {
+		uint64_t probes;
+		uint64_t hits;
+		uint64_t stores;
+		//stores that wrote over a different board
+		uint64_t replaced;
+		//stores dropped because the board was already stored deeper this search
+		uint64_t rejected;
+		//stores dropped because another thread was writing the same entry, and probes that found one mid write
+		uint64_t contended;
+	};
+
+	explicit TranspositionTable(size_t megabytes = 64)
+		: buckets(nullptr), mask(0), age(0), stripeMemory(new char[stripeCount * sizeof(Counters) + 64]),
+		stripes(reinterpret_cast<Counters*>((reinterpret_cast<uintptr_t>(stripeMemory.get()) + 63) & ~uintptr_t(63))) {
+		Resize(megabytes);
+	}
+
+	//rounds down to a power of two buckets and clears everything
+	void Resize(size_t megabytes) {
+		size_t count = 1;
+		while (count * 2 * sizeof(Bucket) <= megabytes * 1024 * 1024)
+			count *= 2;
+		memory.reset(new char[count * sizeof(Bucket) + 64]);
+		buckets = reinterpret_cast<Bucket*>((reinterpret_cast<uintptr_t>(memory.get()) + 63) & ~uintptr_t(63));
+		mask = count - 1;
+		Clear();
+	}
+
+	void Clear() {
+		ClearEntries();
+		for (int s = 0; s < stripeCount; s++)
+			for (std::atomic<uint64_t>& count : stripes[s].counts)
+				count.store(0, std::memory_order_relaxed);
+		age = 0;
+	}
+
+	size_t sizeInBytes() const {
+		return (mask + 1) * sizeof(Bucket);
+	}
+
+	//call between searches, entries from older searches are the first to be replaced
+	//the age is 8 bits, so when it comes round again the entries go, or one 256 searches old would look current
+	void NewSearch() {
+		age = uint8_t(age + 1);
+		if (age == 0)
+			ClearEntries();
+	}
+
+	bool Probe(uint64_t hash, TTEntry& entry) {
+		Counters& counters = stripes[ThreadStripe()];
+		counters.Add(probes);
+		for (Slot& slot : buckets[hash & mask].slots) {
+			uint64_t key = slot.key.load(std::memory_order_acquire);
+			uint64_t data = slot.data.load(std::memory_order_relaxed);
+			if ((key ^ data) == hash && data != 0) {
+				entry = Unpack(data);
+				counters.Add(hits);
+				return true;
+			}
+			if (key == busy)
+				counters.Add(contended);
+		}
+		return false;
+	}
+
+	//keeps an entry for the same board unless it was searched deeper this search,
+	//otherwise goes in an empty entry or over the one with the lowest depth, counting older searches as shallower
+	void Store(uint64_t hash, float score, int depth, int rotation, int x, int y) {
+		Counters& counters = stripes[ThreadStripe()];
+		Slot* victim = nullptr;
+		uint64_t victimKey = 0;
+		uint64_t victimData = 0;
+		int victimWorth = 0;
+		for (Slot& slot : buckets[hash & mask].slots) {
+			uint64_t key = slot.key.load(std::memory_order_acquire);
+			uint64_t data = slot.data.load(std::memory_order_relaxed);
+			if (key == busy)
+				continue;
+			if (data == 0 || (key ^ data) == hash) {
+				if (data != 0 && Depth(data) > depth && Age(data) == age) {
+					counters.Add(rejected);
+					return;
+				}
+				victim = &slot;
+				victimKey = key;
+				victimData = data;
+				break;
+			}
+			int worth = Depth(data) - 4 * uint8_t(age - Age(data));
+			if (!victim || worth < victimWorth) {
+				victim = &slot;
+				victimKey = key;
+				victimData = data;
+				victimWorth = worth;
+			}
+		}
+		//every entry being written by other threads counts as losing the swap
+		if (!victim || !victim->key.compare_exchange_strong(victimKey, busy, std::memory_order_acquire)) {
+			counters.Add(contended);
+			return;
+		}
+		if (victimData != 0 && (victimKey ^ victimData) != hash)
+			counters.Add(replaced);
+		uint64_t data = Pack(score, depth, rotation, x, y);
+		victim->data.store(data, std::memory_order_relaxed);
+		victim->key.store(hash ^ data, std::memory_order_release);
+		counters.Add(stores);
+	}
+
+	//sums every thread's counters, exact once the searches have stopped
+	Stats stats() const {
+		Stats total = Stats();
+		for (int s = 0; s < stripeCount; s++) {
+			const Counters& counters = stripes[s];
+			total.probes += counters.counts[probes].load(std::memory_order_relaxed);
+			total.hits += counters.counts[hits].load(std::memory_order_relaxed);
+			total.stores += counters.counts[stores].load(std::memory_order_relaxed);
+			total.replaced += counters.counts[replaced].load(std::memory_order_relaxed);
+			total.rejected += counters.counts[rejected].load(std::memory_order_relaxed);
+			total.contended += counters.counts[contended].load(std::memory_order_relaxed);
+		}
+		return total;
+	}
+
+private:
+	struct Slot {
+		std::atomic<uint64_t> key;
+		std::atomic<uint64_t> data;
+	};
+	struct alignas(64) Bucket {
+		Slot slots[4];
+	};
+	enum Counter { probes, hits, stores, replaced, rejected, contended, numOfCounters };
+	//each thread counts into its own cache line, the counts are only added up by stats()
+	//an increment is a plain load and store, not a locked add, since only one thread writes a stripe
+	//unless more than stripeCount threads are counting at once, and then a few counts can be lost
+	struct alignas(64) Counters {
+		std::atomic<uint64_t> counts[numOfCounters];
+
+		void Add(Counter counter) {
+			counts[counter].store(counts[counter].load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+		}
+	};
+	//one bit each in the mask of taken stripes
+	static const int stripeCount = 64;
+	//a position is stored offset by margin, which covers every piece position on or just off the grid
+	//and keeps the field of any placement above 0
+	static const int margin = 4;
+	static const int xBits = BitsFor(GridType::width + 2 * margin);
+	static const int yBits = BitsFor(GridType::height + 2 * margin);
+	static_assert(xBits + yBits <= 14, "a position has to fit in the 14 bits after the rotation");
+	//no real entry has this key word, its data would have to be the complement of its hash
+	static const uint64_t busy = ~uint64_t(0);
+
+	std::unique_ptr<char[]> memory;
+	Bucket* buckets;
+	size_t mask;
+	uint8_t age;
+	//the stripes are cache line aligned in memory of their own like the buckets, an aligned member would make the table
+	//over aligned, which new only honours from C++17 on
+	std::unique_ptr<char[]> stripeMemory;
+	Counters* stripes;
+
+	//a thread takes a free stripe the first time it counts and frees it when it ends, so a stripe only has two writers
+	//when every stripe is taken by a running thread, a thread that finds none free shares one
+	struct StripeLease {
+		int stripe;
+		bool owned;
+
+		StripeLease() : stripe(0), owned(false) {
+			uint64_t taken = TakenStripes().load(std::memory_order_relaxed);
+			while (~taken != 0) {
+				int free = 0;
+				while ((taken >> free) & 1)
+					free++;
+				if (TakenStripes().compare_exchange_weak(taken, taken | uint64_t(1) << free, std::memory_order_acquire)) {
+					stripe = free;
+					owned = true;
+					return;
+				}
+			}
+			static std::atomic<int> next(0);
+			stripe = next.fetch_add(1, std::memory_order_relaxed) % stripeCount;
+		}
+		~StripeLease() {
+			if (owned)
+				TakenStripes().fetch_and(~(uint64_t(1) << stripe), std::memory_order_release);
+		}
+	};
+
+	static std::atomic<uint64_t>& TakenStripes() {
+		static std::atomic<uint64_t> taken(0);
+		return taken;
+	}
+
+	static int ThreadStripe() {
+		thread_local StripeLease lease;
+		return lease.stripe;
+	}
+
+	//score bits, then depth, age, rotation and the position offset so it is never negative
+	//a stored entry always has a position, so its data is never 0 and 0 can mean empty
+	uint64_t Pack(float score, int depth, int rotation, int x, int y) const {
+		uint32_t scoreBits;
+		memcpy(&scoreBits, &score, sizeof(scoreBits));
+		return uint64_t(scoreBits) | uint64_t(uint8_t(depth)) << 32 | uint64_t(age) << 40 | uint64_t(rotation & 3) << 48 |
+			uint64_t(x + margin) << 50 | uint64_t(y + margin) << (50 + xBits);
+	}
+
+	TTEntry Unpack(uint64_t data) const {
+		TTEntry entry;
+		uint32_t scoreBits = uint32_t(data);
+		memcpy(&entry.score, &scoreBits, sizeof(scoreBits));
+		entry.depth = Depth(data);
+		entry.rotation = int(data >> 48) & 3;
+		entry.x = int(data >> 50 & FieldMask(xBits)) - margin;
+		entry.y = int(data >> (50 + xBits) & FieldMask(yBits)) - margin;
+		entry.current = Age(data) == age;
+		return entry;
+	}
+
+	void ClearEntries() {
+		for (size_t b = 0; b <= mask; b++)
+			for (Slot& slot : buckets[b].slots) {
+				slot.key.store(0, std::memory_order_relaxed);
+				slot.data.store(0, std::memory_order_relaxed);
+			}
+	}
+
+	static uint64_t FieldMask(int bits) {
+		return (uint64_t(1) << bits) - 1;
+	}
+
+	static int Depth(uint64_t data) {
+		return int(uint8_t(data >> 32));
+	}
+
+	static uint8_t Age(uint64_t data) {
+		return uint8_t(data >> 40);
+	}
+};
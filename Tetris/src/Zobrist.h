@@ -0,0 +1,54 @@
+#pragma once
+#include <Pieces.h>
+#include <cstdint>
+
+//random keys for hashing boards and pieces, a state's hash is the xor of the keys of everything in it
+//the key of the block at (x, y) is the key of column x rotated left by y, so a whole row hashes to
+//its column keys rotated by its height and a row moving down k rows just rotates its hash right by k
+struct ZobristKeys {
+	uint64_t columns[64];
+	//the xor of the column keys of the set bits in byte b of a row, so a row hashes with one lookup per byte
+	uint64_t rowBytes[8][256];
+	uint64_t pieces[numOfBockTypes][4];
+	//piece positions, offset by positionOffset since a piece can hang off the grid
+	uint64_t pieceX[80];
+	uint64_t pieceY[80];
+};
+
+const int positionOffset = 8;
+
+constexpr uint64_t ZobristRotate(uint64_t key, int by) {
+	return (key << (by & 63)) | (key >> ((64 - by) & 63));
+}
+
+constexpr uint64_t SplitMix64(uint64_t& state) {
+	state += 0x9E3779B97F4A7C15ull;
+	uint64_t z = state;
+	z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+	z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+	return z ^ (z >> 31);
+}
+
+constexpr ZobristKeys MakeZobristKeys() {
+	ZobristKeys keys{};
+	uint64_t state = 0x5A0B1257ull;
+	for (uint64_t& key : keys.columns)
+		key = SplitMix64(state);
+	for (int b = 0; b < 8; b++)
+		for (int bits = 1; bits < 256; bits++) {
+			int lowest = 0;
+			while (!((bits >> lowest) & 1))
+				lowest++;
+			keys.rowBytes[b][bits] = keys.rowBytes[b][bits & (bits - 1)] ^ keys.columns[b * 8 + lowest];
+		}
+	for (auto& rotations : keys.pieces)
+		for (uint64_t& key : rotations)
+			key = SplitMix64(state);
+	for (uint64_t& key : keys.pieceX)
+		key = SplitMix64(state);
+	for (uint64_t& key : keys.pieceY)
+		key = SplitMix64(state);
+	return keys;
+}
+
+constexpr ZobristKeys zobristKeys = MakeZobristKeys();
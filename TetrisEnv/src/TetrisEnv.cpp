@@ -0,0 +1,129 @@
+#include <TetrisEnv.h>
+#include <Game.h>
+#include <cstring>
+#include <vector>
+
+typedef Grid<10, 20> Board;
+//actions are passed straight through as keys
+static_assert(int(TETRIS_ACTION_HARD_DROP) == int(KeyHardDrop) && int(TETRIS_ACTION_NONE) == int(numOfKeys), "actions have to match the game's keys");
+
+struct TetrisEnv {
+	std::vector<Game<Board>> games;
+	RandomizerType randomizer;
+	//pieces locked when the board was last written, the board only changes when one locks
+	std::vector<int> boardWritten;
+
+	uint8_t* board;
+	int32_t* piece;
+	int32_t* preview;
+	float* reward;
+	uint8_t* done;
+
+	TetrisEnv(int count, RandomizerType randomizer)
+		: randomizer(randomizer), boardWritten(count, -1),
+		board(nullptr), piece(nullptr), preview(nullptr), reward(nullptr), done(nullptr) {
+		games.reserve(count);
+		for (int i = 0; i < count; i++)
+			games.emplace_back(0, randomizer);
+	}
+
+	void WriteBoard(int i) {
+		const Board& grid = games[i].grid;
+		uint8_t* out = board + size_t(i) * Board::width * Board::height;
+		//rows above the stack are empty
+		size_t filled = grid.stackHeight;
+		for (size_t y = 0; y < filled; y++) {
+			Board::RowMask row = grid.row(y);
+			for (int x = 0; x < Board::width; x++)
+				out[y * Board::width + x] = (row >> x) & 1;
+		}
+		memset(out + filled * Board::width, 0, (Board::height - filled) * Board::width);
+	}
+
+	void Write(int i, float lines) {
+		const Game<Board>& game = games[i];
+		if (board && boardWritten[i] != game.pieces) {
+			WriteBoard(i);
+			boardWritten[i] = game.pieces;
+		}
+		if (piece) {
+			int32_t* out = piece + size_t(i) * 4;
+			out[0] = game.piece.type;
+			out[1] = game.piece.rotation;
+			out[2] = game.piece.pos.x;
+			out[3] = game.piece.pos.y;
+		}
+		if (preview)
+			for (int p = 0; p < PieceQueue::previewSize; p++)
+				preview[size_t(i) * PieceQueue::previewSize + p] = game.queue.Peek(p);
+		if (reward)
+			reward[i] = lines;
+		if (done)
+			done[i] = game.lost;
+	}
+
+	void Reset(int i, uint64_t seed) {
+		games[i] = Game<Board>(seed, randomizer);
+		boardWritten[i] = -1;
+		Write(i, 0);
+	}
+};
+
+TetrisEnv* tetris_env_create(int count, int randomizer) {
+	if (count < 1 || randomizer < 0 || randomizer > int(RandomizerType::History))
+		return nullptr;
+	return new TetrisEnv(count, RandomizerType(randomizer));
+}
+
+void tetris_env_destroy(TetrisEnv* env) {
+	delete env;
+}
+
+int tetris_env_count(const TetrisEnv* env) {
+	return int(env->games.size());
+}
+
+int tetris_env_width(void) {
+	return Board::width;
+}
+
+int tetris_env_height(void) {
+	return Board::height;
+}
+
+int tetris_env_preview_size(void) {
+	return PieceQueue::previewSize;
+}
+
+void tetris_env_set_buffers(TetrisEnv* env, uint8_t* board, int32_t* piece, int32_t* preview, float* reward, uint8_t* done) {
+	env->board = board;
+	env->piece = piece;
+	env->preview = preview;
+	env->reward = reward;
+	env->done = done;
+	//new buffers don't hold the boards yet
+	for (int& written : env->boardWritten)
+		written = -1;
+}
+
+void tetris_env_reset(TetrisEnv* env, const uint64_t* seeds) {
+	for (int i = 0; i < tetris_env_count(env); i++)
+		env->Reset(i, seeds[i]);
+}
+
+void tetris_env_reset_one(TetrisEnv* env, int index, uint64_t seed) {
+	if (index >= 0 && index < tetris_env_count(env))
+		env->Reset(index, seed);
+}
+
+void tetris_env_step(TetrisEnv* env, const uint8_t* actions) {
+	for (int i = 0; i < tetris_env_count(env); i++) {
+		Game<Board>& game = env->games[i];
+		int lines = game.lines;
+		InputFrame input;
+		if (actions[i] < numOfKeys)
+			input.held[actions[i]] = true;
+		game.Step(input);
+		env->Write(i, float(game.lines - lines));
+	}
+}
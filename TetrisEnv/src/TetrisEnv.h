@@ -0,0 +1,61 @@
+#pragma once
+#include <stdint.h>
+
+//a vectorized environment over many headless games, callable from any language with a C FFI
+//observations are written straight into buffers the caller owns, set once with tetris_env_set_buffers,
+//nothing is allocated or copied through a temporary after tetris_env_create
+
+#ifdef _WIN32
+#ifdef TETRIS_ENV_EXPORTS
+#define TETRIS_ENV_API __declspec(dllexport)
+#else
+#define TETRIS_ENV_API __declspec(dllimport)
+#endif
+#else
+#define TETRIS_ENV_API __attribute__((visibility("default")))
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct TetrisEnv TetrisEnv;
+
+//an action holds one key for one tick, the game's own auto-repeat applies when it is held over several steps
+enum {
+	TETRIS_ACTION_RIGHT,
+	TETRIS_ACTION_LEFT,
+	TETRIS_ACTION_DOWN,
+	TETRIS_ACTION_ROTATE,
+	TETRIS_ACTION_HARD_DROP,
+	TETRIS_ACTION_NONE,
+	TETRIS_NUM_ACTIONS
+};
+
+//randomizer is 0 for uniform pieces, 1 for a 7-bag and 2 for a history roll, returns null if count < 1
+TETRIS_ENV_API TetrisEnv* tetris_env_create(int count, int randomizer);
+TETRIS_ENV_API void tetris_env_destroy(TetrisEnv* env);
+
+TETRIS_ENV_API int tetris_env_count(const TetrisEnv* env);
+TETRIS_ENV_API int tetris_env_width(void);
+TETRIS_ENV_API int tetris_env_height(void);
+TETRIS_ENV_API int tetris_env_preview_size(void);
+
+//every buffer holds count entries back to back, any of them can be null to skip that observation
+//board: width * height bytes per game, 1 where a block is set, row 0 at the bottom
+//piece: 4 ints per game, type, rotation, x, y of the falling piece
+//preview: preview_size ints per game, the next piece types in the order they will be dealt
+//reward: lines cleared by the last step
+//done: 1 once the game is lost
+TETRIS_ENV_API void tetris_env_set_buffers(TetrisEnv* env, uint8_t* board, int32_t* piece, int32_t* preview, float* reward, uint8_t* done);
+
+//starts game i over from seeds[i] and writes the first observation
+TETRIS_ENV_API void tetris_env_reset(TetrisEnv* env, const uint64_t* seeds);
+TETRIS_ENV_API void tetris_env_reset_one(TetrisEnv* env, int index, uint64_t seed);
+
+//advances every game by one tick with actions[i], games that are done stay done until they are reset
+TETRIS_ENV_API void tetris_env_step(TetrisEnv* env, const uint8_t* actions);
+
+#ifdef __cplusplus
+}
+#endif